@@ -1,103 +1,469 @@
 // William Yang
-// create_and_test_hash.cc: A test for linear probing, quadratic probing, and double hashing implementations.
+// create_and_test_hash.cc: A test for linear probing, quadratic probing, double hashing, and Robin Hood implementations.
 // Fills hash table provided with a dictionary/words file and prints the hash table's attributes
 // and then queries the hash table with a query file.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
 
 #include "linear_probing.h"
 #include "double_hashing.h"
+#include "flag_parsing.h"
 #include "quadratic_probing.h"
+#include "robin_hood_probing.h"
+#include "inline_key.h"
+#include "huge_page_allocator.h"
+#include "key_arena.h"
+#include "perf_counters.h"
+#include "trace_replay.h"
 
 using namespace std;
 
 
 
-// @hash_table: a hash table (can be linear, quadratic, or double)
+// @filename: a filename of whitespace separated words
+// @description: name of the file for the error message
+// Returns the words of filename; exits if it cannot be read.
+vector<string> ReadWords(const string &filename, const string &description)
+{
+    fstream file(filename);
+    if (!file.is_open())
+    {
+        cerr << "Failed to read " << description << " file." << endl;
+        exit(1);
+    }
+
+    vector<string> words;
+    string word;
+    while (file >> word && !file.fail())
+        words.push_back(move(word));
+
+    file.close();
+    return words;
+}
+
+// Prints the memory footprint of one table or of several added together.
+void PrintMemoryUsage(const TableMemoryUsage &usage)
+{
+    cout << "slot_bytes: " << usage.slot_bytes_ << endl;
+    cout << "key_heap_bytes: " << usage.key_heap_bytes_ << endl;
+    cout << "total_bytes: " << usage.TotalBytes() << endl;
+    cout << "tombstones: " << usage.tombstones_ << endl;
+}
+
+// Prints the memory held by a table's allocator beyond its MemoryUsage().
+// The default allocator holds none.
+template <typename Allocator>
+void PrintAllocatorMemory(const Allocator &)
+{
+}
+
+// Prints how much huge page memory the process has: explicit and transparent.
+template <typename T>
+void PrintAllocatorMemory(const HugePageAllocator<T> &)
+{
+    const HugePageUsage usage = CurrentHugePageUsage();
+    cout << "hugetlb_kb: " << usage.hugetlb_kb_ << endl;
+    cout << "transparent_huge_kb: " << usage.transparent_kb_ << endl;
+}
+
+// Prints the bytes of the key arena, then the memory of the slot allocator.
+template <typename SlotAllocator>
+void PrintAllocatorMemory(const ArenaKeyAllocator<ArenaString, SlotAllocator> &allocator)
+{
+    const MonotonicArena *arena = allocator.inner_allocator().Arena();
+    cout << "key_arena_bytes: " << (arena != nullptr ? arena->Bytes() : 0) << endl;
+    cout << "key_arena_used_bytes: " << (arena != nullptr ? arena->UsedBytes() : 0) << endl;
+    PrintAllocatorMemory(allocator.outer_allocator());
+}
+
+// Prints statistics particular to an implementation after the common attributes.
+// Linear, quadratic, and double hashing have none.
+template <typename HashTableType>
+void PrintProbeStatistics(const HashTableType &)
+{
+}
+
+// Prints how far the elements of a Robin Hood table are from their home slots.
+template <typename HashedObj, typename HashFunc, typename Allocator>
+void PrintProbeStatistics(const HashTableRobinHood<HashedObj, HashFunc, Allocator> &hash_table)
+{
+    cout << "max_displacement: " << hash_table.MaxDisplacement() << endl;
+    cout << "mean_displacement: " << hash_table.MeanDisplacement() << endl;
+}
+
+// @hash_table: a hash table (can be linear, quadratic, double, or robinhood)
 // @words_filename: a filename of input words to construct the hash table
 // @query_filename: a filename of input words to test the hash table
+// @perf_counters: if not null, hardware counters measured around the insert
+// and query phases and printed per operation
+// @print_memory: if true, the memory footprint is printed after the attributes
 // A test function for hash table classes to track the attributes of
 // each hash table implementation.
-template <typename HashTableType>
+// The files are read and converted to KeyType keys before each phase so that
+// only table operations are measured.
+template <typename KeyType, typename HashTableType>
 void TestFunctionForHashTable(HashTableType &hash_table,
 			      const string &words_filename,
-			      const string &query_filename)
+			      const string &query_filename,
+			      PerfCounters *perf_counters = nullptr,
+			      bool print_memory = false)
 {
     hash_table.MakeEmpty();
 
     // Read words file.
-    fstream words_file(words_filename);
-    if (!words_file.is_open())
-    {
-        cerr << "Failed to read words file." << endl;
-        exit(1);
-    }
+    vector<string> words = ReadWords(words_filename, "words");
+    vector<KeyType> keys(make_move_iterator(words.begin()), make_move_iterator(words.end()));
+    const size_t insert_count = keys.size();
 
-    string word;
     // Insert words into hash table.
-    while (words_file >> word && !words_file.fail())
-    {
-        hash_table.Insert(move(word));
-    }
-
-    words_file.close();
+    if (perf_counters != nullptr)
+        perf_counters->Start();
+    for (auto &key : keys)
+        hash_table.Insert(move(key));
+    if (perf_counters != nullptr)
+        perf_counters->Stop();
 
     // Hash table attributes.
     cout << "number_of_elements: " << hash_table.Size() << endl;
     cout << "size_of_table: " << hash_table.Capacity() << endl;
     cout << "load_factor: " << hash_table.LoadFactor() << endl;
     cout << "collisions: " << hash_table.TotalCollisions() << endl;
-    cout << "avg_collisions: " << hash_table.AverageCollisions() << "\n\n";
+    cout << "avg_collisions: " << hash_table.AverageCollisions() << endl;
+    PrintProbeStatistics(hash_table);
+    cout << "\n";
+    if (print_memory)
+    {
+        PrintMemoryUsage(hash_table.MemoryUsage());
+        PrintAllocatorMemory(hash_table.GetAllocator());
+        cout << "\n";
+    }
+    if (perf_counters != nullptr)
+    {
+        perf_counters->Print(cout, "insert", insert_count);
+        cout << "\n";
+    }
 
     // Read query.
-    fstream query(query_filename);
-    if (!query.is_open())
+    const vector<string> query = ReadWords(query_filename, "query");
+    vector<KeyType> query_keys;
+    query_keys.reserve(query.size());
+    for (const auto &word : query)
+        query_keys.push_back(LookupKey<KeyType>(word));
+    vector<size_t> probes(query.size());
+    vector<bool> found(query.size());
+
+    // Query hash table.
+    if (perf_counters != nullptr)
+        perf_counters->Start();
+    for (size_t i = 0; i < query.size(); i++)
     {
-        cerr << "Failed to read query file." << endl;
-        exit(1);
+        found[i] = hash_table.Contains(query_keys[i]);
+        probes[i] = hash_table.ProbesUsed();
     }
+    if (perf_counters != nullptr)
+        perf_counters->Stop();
 
-    // Query hash table.
-    while (query >> word)
+    for (size_t i = 0; i < query.size(); i++)
     {
-        if(hash_table.Contains(word))
-            cout << word << " Found " << hash_table.ProbesUsed() << endl;
+        if (found[i])
+            cout << query[i] << " Found " << probes[i] << endl;
         else
-            cout << word << " Not_Found " << hash_table.ProbesUsed() << endl;
+            cout << query[i] << " Not_Found " << probes[i] << endl;
     }
 
-    query.close();
+    if (perf_counters != nullptr)
+    {
+        cout << "\n";
+        perf_counters->Print(cout, "query", query.size());
+    }
 }
 
-// @argument_count: argc as provided in main
-// @argument_list: argv as provided in imain
-// Calls the specific testing function for hash table (linear, quadratic, or double).
-int testHashingWrapper(int argument_count, char **argument_list)
+// Options for testHashingWrapper(), set from optional command line arguments.
+struct HashTestOptions {
+    // R value used by double hashing, 0 for adaptive.
+    int r_value_ = 89;
+    // Store keys as InlineKey instead of string.
+    bool inline_keys_ = false;
+    // Allocate the slot arrays with HugePageAllocator.
+    bool huge_pages_ = false;
+    // Store keys as ArenaString, their chars in a MonotonicArena.
+    bool key_arena_ = false;
+    // Print the hash seed before the table attributes.
+    bool print_seed_ = false;
+    // Measure hardware performance counters around the insert and query phases.
+    bool perf_counters_ = false;
+    // Print the memory footprint of the table.
+    bool print_memory_ = false;
+    // Let the tables shrink after removals (ShrinkPolicy defaults).
+    bool shrink_ = false;
+    // Trace file to replay instead of the insert and query test (empty for none).
+    string replay_filename_;
+    // Operations of a synthetic trace over the query words to replay (0 for none).
+    size_t synthetic_ops_ = 0;
+    // Fraction of contains operations in the synthetic trace.
+    double read_ratio_ = 0.9;
+    // Zipf exponent of key popularity in the synthetic trace (0 for uniform).
+    double zipf_skew_ = 0.99;
+    // Threads replaying the trace.
+    size_t replay_threads_ = 1;
+    // Tables the keys are sharded over during a replay, 0 for one per thread.
+    size_t replay_shards_ = 0;
+    // File the replayed trace is written to in binary (empty for none).
+    string write_trace_filename_;
+
+    // Returns true if a trace is replayed instead of the insert and query test.
+    bool Replay() const {
+        return !replay_filename_.empty() || synthetic_ops_ > 0;
+    }
+};
+
+// @prototype: an empty hash table (can be linear, quadratic, double, or robinhood) copied into every shard
+// @words_filename: a filename of input words preloaded into the tables
+// @query_filename: a filename of input words, most popular first, for synthetic traces
+// @options: the trace to replay and how
+// Replays a trace of mixed insert/contains/remove operations against the tables
+// and prints the throughput, latency percentiles and peak memory.
+// The trace is read from options.replay_filename_, or generated from the query
+// words and the hash seed when options.synthetic_ops_ is set.
+// The tables hold KeyType keys.
+template <typename KeyType, typename HashTableType>
+void ReplayFunctionForHashTable(const HashTableType &prototype,
+                                const string &words_filename,
+                                const string &query_filename,
+                                const HashTestOptions &options)
 {
-    const string words_filename(argument_list[1]);
-    const string query_filename(argument_list[2]);
-    const string param_flag(argument_list[3]);
-    int R = 89;
-    if (argument_count == 5) {
-	    const string rvalue(argument_list[4]);
-	    R = stoi(rvalue); // Aborts program if R isn't a number.
+    Trace trace;
+    if (!options.replay_filename_.empty())
+    {
+        size_t bad_line = 0;
+        if (!ReadTrace(options.replay_filename_, trace, &bad_line))
+        {
+            cerr << "Failed to read trace file";
+            if (bad_line > 0)
+                cerr << ": line " << bad_line << " is not an operation and a key";
+            cerr << "." << endl;
+            exit(1);
+        }
+    }
+    else
+        trace = GenerateTrace(ReadWords(query_filename, "query"), options.synthetic_ops_,
+                              options.read_ratio_, options.zipf_skew_, DefaultHashSeed());
+    if (!options.write_trace_filename_.empty() && !WriteBinaryTrace(options.write_trace_filename_, trace))
+        cerr << "Failed to write trace file." << endl;
+
+    const size_t shard_count = options.replay_shards_ > 0 ? options.replay_shards_ : options.replay_threads_;
+    vector<HashTableType> shards(shard_count, prototype);
+    InsertIntoShards<KeyType>(shards, ReadWords(words_filename, "words"), DefaultHashSeed());
+
+    const ReplayReport report = ReplayTrace<KeyType>(shards, trace, options.replay_threads_, DefaultHashSeed());
+    cout << "replay_ops: " << report.ops_ << endl;
+    cout << "replay_threads: " << report.threads_ << endl;
+    cout << "replay_shards: " << shard_count << endl;
+    cout << "ops_per_sec: " << report.ops_per_second_ << endl;
+    cout << "latency_ns_p50: " << report.p50_ns_ << endl;
+    cout << "latency_ns_p90: " << report.p90_ns_ << endl;
+    cout << "latency_ns_p99: " << report.p99_ns_ << endl;
+    cout << "latency_ns_p999: " << report.p999_ns_ << endl;
+    cout << "latency_ns_max: " << report.max_ns_ << endl;
+    cout << "final_elements: " << report.final_size_ << endl;
+    PrintMemoryUsage(report.memory_);
+    PrintAllocatorMemory(prototype.GetAllocator());
+    cout << "max_rss_kb: " << report.max_rss_kb_ << endl;
+}
+
+// Runs the replay if options ask for one, otherwise the test function, on hash_table.
+template <typename KeyType, typename HashTableType>
+void RunHashTableTest(HashTableType &hash_table, const HashTestOptions &options,
+                      const string &words_filename, const string &query_filename,
+                      PerfCounters *perf_counters)
+{
+    if (options.shrink_)
+    {
+        ShrinkPolicy policy;
+        policy.enabled_ = true;
+        hash_table.SetShrinkPolicy(policy);
+    }
+    if (options.Replay())
+        ReplayFunctionForHashTable<KeyType>(hash_table, words_filename, query_filename, options);
+    else
+        TestFunctionForHashTable<KeyType>(hash_table, words_filename, query_filename, perf_counters, options.print_memory_);
+}
+
+
+// Parses the optional arguments following the flag:
+// <r value>       R value for double hashing, 0 to scale it with the table size
+// --inline-keys   store keys inline in the table slots (InlineKey)
+// --alloc=<list>  comma separated allocators: default, hugepage (slot arrays on
+//                 2MB pages) and/or arena (ArenaString keys in a MonotonicArena)
+// --seed=<n>      hash seed (default 0); equal seeds give equal statistics everywhere
+// --random-seed   unpredictable hash seed, for untrusted input
+// --perf          print hardware performance counters per insert and per query
+// --memory        print the memory footprint of the table: slots, key heap bytes, tombstones
+// --shrink        let the tables shrink when removals leave them sparse
+// --replay=<file> replay a text or binary trace of insert/contains/remove operations
+//                 against the tables preloaded with the words file
+// --synthetic=<n> replay n operations over the query words, most popular first
+// --read-ratio=<f> fraction of contains operations in the synthetic trace, 0 to 1 (default 0.9)
+// --zipf=<s>      Zipf exponent of key popularity in the synthetic trace, 0 to 100 (default 0.99)
+// --threads=<n>   threads replaying the trace (default 1)
+// --shards=<n>    mutex guarded tables the keys are spread over (default one per thread)
+// --write-trace=<file> write the replayed trace in binary
+HashTestOptions ParseHashTestOptions(int argument_count, char **argument_list)
+{
+    HashTestOptions options;
+    for (int i = 4; i < argument_count; i++) {
+        const string argument(argument_list[i]);
+        if (argument == "--inline-keys")
+            options.inline_keys_ = true;
+        else if (argument.compare(0, 8, "--alloc=") == 0) {
+            stringstream allocators(argument.substr(8));
+            string allocator;
+            while (getline(allocators, allocator, ',')) {
+                if (allocator == "hugepage")
+                    options.huge_pages_ = true;
+                else if (allocator == "arena")
+                    options.key_arena_ = true;
+                else if (allocator != "default")
+                    cerr << "Ignoring unknown allocator " << allocator << endl;
+            }
+        }
+        else if (argument == "--perf")
+            options.perf_counters_ = true;
+        else if (argument == "--memory")
+            options.print_memory_ = true;
+        else if (argument == "--shrink")
+            options.shrink_ = true;
+        else if (argument.compare(0, 7, "--seed=") == 0) {
+            SetDefaultHashSeed(ParseUnsignedFlag(argument, argument.substr(7)));
+            options.print_seed_ = true;
+        } else if (argument == "--random-seed") {
+            SetDefaultHashSeed(RandomHashSeed());
+            options.print_seed_ = true;
+        }
+        else if (argument.compare(0, 9, "--replay=") == 0)
+            options.replay_filename_ = argument.substr(9);
+        else if (argument.compare(0, 12, "--synthetic=") == 0)
+            options.synthetic_ops_ = ParseUnsignedFlag(argument, argument.substr(12));
+        else if (argument.compare(0, 13, "--read-ratio=") == 0)
+            options.read_ratio_ = ParseRealFlag(argument, argument.substr(13), 0, 1);
+        else if (argument.compare(0, 7, "--zipf=") == 0)
+            options.zipf_skew_ = ParseRealFlag(argument, argument.substr(7), 0, 100);
+        else if (argument.compare(0, 10, "--threads=") == 0)
+            options.replay_threads_ = max<size_t>(1, ParseUnsignedFlag(argument, argument.substr(10)));
+        else if (argument.compare(0, 9, "--shards=") == 0)
+            options.replay_shards_ = ParseUnsignedFlag(argument, argument.substr(9));
+        else if (argument.compare(0, 14, "--write-trace=") == 0)
+            options.write_trace_filename_ = argument.substr(14);
+        else if (argument.compare(0, 2, "--") == 0)
+            cerr << "Ignoring unknown option " << argument << endl;
+        else
+            options.r_value_ = stoi(argument); // Aborts program if R isn't a number.
+    }
+    // Replay shards are copies of the table, and a copied table does not take
+    // the arena along, so arena keys cannot be replayed.
+    if (options.key_arena_ && options.Replay())
+    {
+        cerr << "--alloc=arena cannot be combined with --replay or --synthetic." << endl;
+        exit(1);
+    }
+    // PerfCounters count the calling thread only, not the replay threads.
+    if (options.perf_counters_ && options.Replay())
+    {
+        cerr << "--perf cannot be combined with --replay or --synthetic." << endl;
+        exit(1);
+    }
+    return options;
+}
+
+// @param_flag: linear, quadratic, double, or robinhood
+// @allocator: allocator of the table's slots
+// Runs the test function on a hash table of the given implementation holding KeyType keys.
+template <typename KeyType, typename Allocator>
+void TestHashTableOfKeys(const string &param_flag, const HashTestOptions &options,
+                         const string &words_filename, const string &query_filename,
+                         const Allocator &allocator)
+{
+    unique_ptr<PerfCounters> perf_counters;
+    if (options.perf_counters_) {
+        perf_counters.reset(new PerfCounters);
+        if (!perf_counters->Available())
+            cerr << "Performance counters unavailable: " << perf_counters->Error() << endl;
     }
 
     if (param_flag == "linear") {
-        HashTableLinear<string> linear_probing_table;
-        TestFunctionForHashTable(linear_probing_table, words_filename, query_filename);
+        HashTableLinear<KeyType, SeededHash<KeyType>, Allocator> linear_probing_table(101, SeededHash<KeyType>(), allocator);
+        RunHashTableTest<KeyType>(linear_probing_table, options, words_filename, query_filename, perf_counters.get());
     } else if (param_flag == "quadratic") {
-	    HashTable<string> quadratic_probing_table;
-	    TestFunctionForHashTable(quadratic_probing_table, words_filename, query_filename);
+        HashTable<KeyType, SeededHash<KeyType>, Allocator> quadratic_probing_table(101, SeededHash<KeyType>(), allocator);
+        RunHashTableTest<KeyType>(quadratic_probing_table, options, words_filename, query_filename, perf_counters.get());
     } else if (param_flag == "double") {
-	    cout << "r_value: " << R << endl;
-        HashTableDouble<string> double_probing_table(101, R);
-        TestFunctionForHashTable(double_probing_table, words_filename, query_filename);
+        HashTableDouble<KeyType, SeededHash<KeyType>, Allocator> double_probing_table(101, options.r_value_, SeededHash<KeyType>(), allocator);
+        // The modulus in use: a positive r is capped below the table size.
+        cout << "r_value: " << double_probing_table.RValue();
+        if (options.r_value_ <= 0)
+            cout << " (adaptive)";
+        cout << endl;
+        RunHashTableTest<KeyType>(double_probing_table, options, words_filename, query_filename, perf_counters.get());
+    } else if (param_flag == "robinhood") {
+        HashTableRobinHood<KeyType, SeededHash<KeyType>, Allocator> robin_hood_table(101, SeededHash<KeyType>(), allocator);
+        RunHashTableTest<KeyType>(robin_hood_table, options, words_filename, query_filename, perf_counters.get());
     } else {
-	    cout << "Unknown tree type " << param_flag << " (User should provide linear, quadratic, or double)" << endl;
+        cout << "Unknown tree type " << param_flag << " (User should provide linear, quadratic, double, or robinhood)" << endl;
     }
+}
+
+// Runs TestHashTableOfKeys() with slot arrays on huge pages if options ask for them.
+template <typename KeyType>
+void TestHashTableOfKeysInSlots(const string &param_flag, const HashTestOptions &options,
+                                const string &words_filename, const string &query_filename)
+{
+    if (options.huge_pages_)
+        TestHashTableOfKeys<KeyType>(param_flag, options, words_filename, query_filename, HugePageAllocator<KeyType>());
+    else
+        TestHashTableOfKeys<KeyType>(param_flag, options, words_filename, query_filename, allocator<KeyType>());
+}
+
+// Runs TestHashTableOfKeys() on ArenaString keys whose chars come from an
+// arena of the table, released when the table is emptied or destroyed.
+void TestHashTableOfArenaKeys(const string &param_flag, const HashTestOptions &options,
+                              const string &words_filename, const string &query_filename)
+{
+    const shared_ptr<MonotonicArena> arena = make_shared<MonotonicArena>();
+    const ArenaAllocator<char> key_allocator(arena);
+    if (options.huge_pages_)
+        TestHashTableOfKeys<ArenaString>(param_flag, options, words_filename, query_filename,
+            ArenaKeyAllocator<ArenaString, HugePageAllocator<ArenaString>>(HugePageAllocator<ArenaString>(), key_allocator));
+    else
+        TestHashTableOfKeys<ArenaString>(param_flag, options, words_filename, query_filename,
+            ArenaKeyAllocator<ArenaString>(allocator<ArenaString>(), key_allocator));
+}
+
+// @argument_count: argc as provided in main
+// @argument_list: argv as provided in imain
+// Calls the specific testing function for hash table (linear, quadratic, double, or robinhood).
+int testHashingWrapper(int argument_count, char **argument_list)
+{
+    const string words_filename(argument_list[1]);
+    const string query_filename(argument_list[2]);
+    const string param_flag(argument_list[3]);
+    const HashTestOptions options = ParseHashTestOptions(argument_count, argument_list);
+    if (options.print_seed_)
+        cout << "hash_seed: " << DefaultHashSeed() << endl;
+
+    if (options.key_arena_) {
+        if (options.inline_keys_)
+            cerr << "Ignoring --inline-keys: --alloc=arena stores ArenaString keys." << endl;
+        TestHashTableOfArenaKeys(param_flag, options, words_filename, query_filename);
+    } else if (options.inline_keys_)
+        TestHashTableOfKeysInSlots<InlineKey>(param_flag, options, words_filename, query_filename);
+    else
+        TestHashTableOfKeysInSlots<string>(param_flag, options, words_filename, query_filename);
     return 0;
 }
 
@@ -108,11 +474,15 @@ int testHashingWrapper(int argument_count, char **argument_list)
 /*
 int main(int argc, char **argv)
 {
-    if (argc != 4 and argc != 5) {
+    if (argc < 4) {
 	cout << "Usage: " << argv[0]
 	     << " <wordsfilename> <queryfilename> <flag>" << endl;
 	cout << "or Usage: " << argv[0]
 	     << " <wordsfilename> <queryfilename> <flag> <rvalue>" << endl;
+	cout << "optionally followed by --inline-keys, --alloc=<default|hugepage|arena>, --seed=<n>, --random-seed," << endl;
+	cout << "--perf, --memory, --shrink," << endl;
+	cout << "--replay=<trace>, --synthetic=<n>, --read-ratio=<f>, --zipf=<s>, --threads=<n>," << endl;
+	cout << "--shards=<n> or --write-trace=<file>" << endl;
 	return 0;
     }
 
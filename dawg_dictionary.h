@@ -0,0 +1,272 @@
+// William Yang
+// dawg_dictionary.h: A compact dictionary stored as a minimized acyclic automaton (DAWG).
+
+#ifndef DAWG_DICTIONARY_H
+#define DAWG_DICTIONARY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+
+// Class DawgDictionary:
+// A set of words stored as a directed acyclic word graph: the trie of the words
+// with equal suffix subtrees merged, so words share their prefixes and their
+// suffixes. The automaton is one flat array of 32-bit edges. The edges leaving a
+// state are consecutive and sorted by label; each edge packs its label, whether
+// the word ending with it is accepted, whether it is the last edge of its state,
+// and the index of the first edge of the state it leads to.
+// Words are read a char at a time from a State, so callers testing many words
+// with a common prefix can walk the prefix once.
+class DawgDictionary {
+public:
+    // A position in the automaton after reading a prefix.
+    struct State {
+        // Index of the first edge leaving the state, 0 if none leave it.
+        uint32_t first_edge_;
+        // True if the prefix read so far is a word.
+        bool final_;
+    };
+
+    // Constructor for an empty dictionary.
+    DawgDictionary() : edges_(1, 0) { }
+
+    // Replaces the contents of the dictionary with words, in any order and with
+    // any duplicates. Sorts words in place.
+    // Returns false, leaving the dictionary empty, if the automaton needs more
+    // edges than an edge can address (kMaxEdges).
+    bool Build(std::vector<std::string>& words) {
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        Builder builder;
+        for (const auto& word : words)
+            builder.Add(word);
+        builder.Finish();
+
+        edges_.assign(1, 0);
+        word_count_ = 0;
+        accepts_empty_ = false;
+        if (!builder.Flatten(edges_))
+            return false;
+        edges_.shrink_to_fit();
+        word_count_ = words.size();
+        accepts_empty_ = builder.RootIsFinal();
+        return true;
+    }
+
+    // Returns the state before any char is read.
+    State Root() const {
+        return State{ edges_.size() > 1 ? 1u : 0u, accepts_empty_ };
+    }
+
+    // Reads c from state.
+    // Returns false if no word continues with c; state is then unchanged.
+    bool Step(State& state, char c) const {
+        if (state.first_edge_ == 0)
+            return false;
+        const uint32_t label = (unsigned char)c;
+        for (uint32_t i = state.first_edge_; ; i++) {
+            const uint32_t edge = edges_[i];
+            const uint32_t edge_label = edge & kLabelMask;
+            if (edge_label == label) {
+                state = State{ edge >> kTargetShift, (edge & kFinalBit) != 0 };
+                return true;
+            }
+            if (edge_label > label || (edge & kLastBit) != 0)
+                return false;
+        }
+    }
+
+    // Reads length chars at data from state.
+    // Returns false if no word continues with them.
+    bool Walk(State& state, const char* data, size_t length) const {
+        for (size_t i = 0; i < length; i++)
+            if (!Step(state, data[i]))
+                return false;
+        return true;
+    }
+
+    // Calls visit(label, next_state) for each char a word can continue with after
+    // state, in increasing order of the chars.
+    template <typename Visitor>
+    void ForEachNext(const State& state, Visitor visit) const {
+        if (state.first_edge_ == 0)
+            return;
+        for (uint32_t i = state.first_edge_; ; i++) {
+            const uint32_t edge = edges_[i];
+            visit((char)(edge & kLabelMask), State{ edge >> kTargetShift, (edge & kFinalBit) != 0 });
+            if ((edge & kLastBit) != 0)
+                return;
+        }
+    }
+
+    // Check if the dictionary contains x.
+    // Return true if x is found;
+    // false otherwise.
+    bool Contains(const std::string& x) const {
+        State state = Root();
+        return Walk(state, x.data(), x.size()) && state.final_;
+    }
+
+    // Returns the number of words in the dictionary.
+    size_t Size() const {
+        return word_count_;
+    }
+
+    // Returns the number of edges of the automaton.
+    size_t EdgeCount() const {
+        return edges_.size() - 1;
+    }
+
+    // Returns the bytes used by the dictionary.
+    size_t Bytes() const {
+        return sizeof(*this) + edges_.capacity() * sizeof(uint32_t);
+    }
+
+    // Most edges an automaton can have, limited by the bits of an edge's target index.
+    static const uint32_t kMaxEdges = (1u << 22) - 1;
+
+private:
+    // Edge layout: label in bits 0-7, final in bit 8, last in bit 9, target in bits 10-31.
+    static const uint32_t kLabelMask = 0xFF;
+    static const uint32_t kFinalBit = 1u << 8;
+    static const uint32_t kLastBit = 1u << 9;
+    static const uint32_t kTargetShift = 10;
+
+    // Edges of all states. Edge 0 is unused, so that a target of 0 means no edges.
+    std::vector<uint32_t> edges_;
+    // Number of words.
+    size_t word_count_ = 0;
+    // True if the empty word is in the dictionary.
+    bool accepts_empty_ = false;
+
+    // Class Builder:
+    // Builds the minimal automaton of words added in sorted order, minimizing
+    // incrementally (Daciuk et al., 2000): when a word is added, the states of
+    // the previous word past their common prefix can no longer change, so each is
+    // replaced by an equivalent registered state or registered itself.
+    class Builder {
+    public:
+        Builder() : nodes_(1) { }
+
+        // Adds word, which must sort after the previously added word.
+        void Add(const std::string& word) {
+            size_t common = 0;
+            while (common < word.size() && common < previous_.size() && word[common] == previous_[common])
+                common++;
+            Minimize(common);
+
+            uint32_t node = unchecked_.empty() ? 0 : unchecked_.back().child_;
+            for (size_t i = common; i < word.size(); i++) {
+                const uint32_t child = (uint32_t)nodes_.size();
+                nodes_.emplace_back();
+                nodes_[node].edges_.emplace_back((unsigned char)word[i], child);
+                unchecked_.push_back(Unchecked{ node, child });
+                node = child;
+            }
+            nodes_[node].final_ = true;
+            previous_ = word;
+        }
+
+        // Minimizes the states of the last word.
+        void Finish() {
+            Minimize(0);
+        }
+
+        // Returns true if the empty word was added.
+        bool RootIsFinal() const {
+            return nodes_[0].final_;
+        }
+
+        // Appends the edges of the states reachable from the root to edges,
+        // which holds the unused edge 0. Returns false if there are too many.
+        bool Flatten(std::vector<uint32_t>& edges) const {
+            // Give every state with edges the index of its first edge.
+            std::vector<uint32_t> first_edge(nodes_.size(), 0);
+            std::vector<uint32_t> order{ 0 };
+            size_t edge_count = 1;
+            first_edge[0] = nodes_[0].edges_.empty() ? 0 : 1;
+            edge_count += nodes_[0].edges_.size();
+            for (size_t i = 0; i < order.size(); i++)
+                for (const auto& edge : nodes_[order[i]].edges_) {
+                    const uint32_t child = edge.second;
+                    if (first_edge[child] != 0 || nodes_[child].edges_.empty())
+                        continue;
+                    first_edge[child] = (uint32_t)edge_count;
+                    edge_count += nodes_[child].edges_.size();
+                    order.push_back(child);
+                    if (edge_count > kMaxEdges + 1)
+                        return false;
+                }
+
+            edges.reserve(edge_count);
+            for (uint32_t node : order) {
+                const auto& node_edges = nodes_[node].edges_;
+                for (size_t e = 0; e < node_edges.size(); e++) {
+                    const uint32_t child = node_edges[e].second;
+                    uint32_t edge = node_edges[e].first | (first_edge[child] << kTargetShift);
+                    if (nodes_[child].final_)
+                        edge |= kFinalBit;
+                    if (e + 1 == node_edges.size())
+                        edge |= kLastBit;
+                    edges.push_back(edge);
+                }
+            }
+            return true;
+        }
+
+    private:
+        // A state under construction.
+        struct Node {
+            // True if the word ending here was added.
+            bool final_ = false;
+            // (label, child) pairs, sorted by label.
+            std::vector<std::pair<unsigned char, uint32_t>> edges_;
+        };
+
+        // An edge of the last word whose child is not minimized yet.
+        struct Unchecked {
+            uint32_t parent_;
+            uint32_t child_;
+        };
+
+        // All states created; replaced states stay unreachable.
+        std::vector<Node> nodes_;
+        // Edges of the last word past the root, from the root down.
+        std::vector<Unchecked> unchecked_;
+        // Minimized states, by Signature().
+        std::unordered_map<std::string, uint32_t> register_;
+        // The last word added.
+        std::string previous_;
+
+        // Returns a key equal for equivalent minimized states.
+        std::string Signature(uint32_t node) const {
+            std::string signature(1, nodes_[node].final_ ? '1' : '0');
+            for (const auto& edge : nodes_[node].edges_) {
+                signature += (char)edge.first;
+                signature.append(reinterpret_cast<const char*>(&edge.second), sizeof(edge.second));
+            }
+            return signature;
+        }
+
+        // Minimizes the unchecked states deeper than down_to chars.
+        void Minimize(size_t down_to) {
+            while (unchecked_.size() > down_to) {
+                const Unchecked last = unchecked_.back();
+                unchecked_.pop_back();
+                auto inserted = register_.emplace(Signature(last.child_), last.child_);
+                if (!inserted.second) {
+                    nodes_[last.parent_].edges_.back().second = inserted.first->second;
+                    nodes_[last.child_] = Node();   // Unreachable now; free its edges.
+                }
+            }
+        }
+    };
+};
+
+#endif  // DAWG_DICTIONARY_H
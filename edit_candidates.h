@@ -0,0 +1,250 @@
+// William Yang
+// edit_candidates.h: Generates and checks the spelling alternatives one edit away from a word.
+
+#ifndef EDIT_CANDIDATES_H
+#define EDIT_CANDIDATES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dawg_dictionary.h"
+
+
+
+// A word one edit away from the word given to EditCandidates::Generate().
+struct EditCandidate {
+    // Kind of edit, in the order candidates are generated.
+    enum Kind : unsigned char { INSERTION, DELETION, TRANSPOSITION, SUBSTITUTION };
+
+    // The edit.
+    Kind kind_;
+    // True if the candidate is in the dictionary, set by EditCandidates::Check().
+    bool found_;
+    // Index of the first char that differs from the word; the chars before it are shared.
+    uint32_t position_;
+    // Index of the candidate's first char in the candidate buffer.
+    uint32_t offset_;
+    // Number of chars of the candidate.
+    uint32_t length_;
+};
+
+// Class EditCandidates:
+// Every distinct word one edit away from a misspelled word: a-z inserted at each
+// position, each char deleted, each pair of adjacent chars transposed and,
+// optionally, each char substituted by another of a-z. Candidates are written
+// back to back into one char buffer and kept in generation order, with
+// duplicates (the same word reached by two edits) dropped through a small open
+// addressing set. The buffers only grow, so once they fit the longest word seen,
+// generating and checking candidates does not allocate.
+class EditCandidates {
+public:
+    // Constructor for the candidate buffers.
+    // Substitutions are generated only if substitutions is true.
+    // The buffers are sized for words of up to reserve_length chars.
+    explicit EditCandidates(bool substitutions = false, size_t reserve_length = 32)
+        : substitutions_(substitutions) {
+        Reserve(reserve_length);
+    }
+
+    // Replaces the candidates with the distinct edits of word.
+    void Generate(const std::string& word) {
+        Reserve(word.size());
+        word_.assign(word);
+        count_ = 0;
+        buffer_used_ = 0;
+        NextStamp();
+
+        const size_t length = word.size();
+        for (size_t i = 0; i <= length; i++)
+            for (char c = 'a'; c <= 'z'; c++) {
+                char* candidate = Start();
+                std::memcpy(candidate, word.data(), i);
+                candidate[i] = c;
+                std::memcpy(candidate + i + 1, word.data() + i, length - i);
+                Add(EditCandidate::INSERTION, i, length + 1);
+            }
+
+        for (size_t i = 0; i < length; i++) {
+            char* candidate = Start();
+            std::memcpy(candidate, word.data(), i);
+            std::memcpy(candidate + i, word.data() + i + 1, length - i - 1);
+            Add(EditCandidate::DELETION, i, length - 1);
+        }
+
+        for (size_t i = 0; i + 1 < length; i++) {
+            if (word[i] == word[i + 1])   // Transposing equal chars gives the word back.
+                continue;
+            char* candidate = Start();
+            std::memcpy(candidate, word.data(), length);
+            std::swap(candidate[i], candidate[i + 1]);
+            Add(EditCandidate::TRANSPOSITION, i, length);
+        }
+
+        if (!substitutions_)
+            return;
+        for (size_t i = 0; i < length; i++)
+            for (char c = 'a'; c <= 'z'; c++) {
+                if (c == word[i])
+                    continue;
+                char* candidate = Start();
+                std::memcpy(candidate, word.data(), length);
+                candidate[i] = c;
+                Add(EditCandidate::SUBSTITUTION, i, length);
+            }
+    }
+
+    // Marks the candidates found in dictionary, which has Contains(const std::string&) const.
+    // Returns the number found.
+    template <typename DictionaryType>
+    size_t Check(const DictionaryType& dictionary) {
+        size_t found = 0;
+        for (size_t i = 0; i < count_; i++) {
+            EditCandidate& candidate = candidates_[i];
+            scratch_.assign(Data(candidate), candidate.length_);
+            candidate.found_ = dictionary.Contains(scratch_);
+            found += candidate.found_;
+        }
+        return found;
+    }
+
+    // Marks the candidates found in a DAWG dictionary.
+    // The word's prefixes are walked once; each candidate resumes from the state
+    // of the prefix it shares with the word. Candidates whose first differing
+    // char cannot follow that prefix are rejected without walking.
+    // Returns the number found.
+    size_t Check(const DawgDictionary& dictionary) {
+        if (prefix_states_.size() < word_.size() + 1) {
+            prefix_states_.resize(word_.size() + 1);
+            next_chars_.resize(word_.size() + 1);
+        }
+        size_t walkable = 1;
+        prefix_states_[0] = dictionary.Root();
+        DawgDictionary::State state = prefix_states_[0];
+        while (walkable <= word_.size() && dictionary.Step(state, word_[walkable - 1]))
+            prefix_states_[walkable++] = state;
+
+        // Bit c - 'a' of next_chars_[i] is set if c can follow the first i chars.
+        for (size_t i = 0; i < walkable; i++) {
+            uint32_t next_chars = 0;
+            dictionary.ForEachNext(prefix_states_[i], [&](char c, const DawgDictionary::State&) {
+                if (c >= 'a' && c <= 'z')
+                    next_chars |= 1u << (c - 'a');
+            });
+            next_chars_[i] = next_chars;
+        }
+
+        size_t found = 0;
+        for (size_t i = 0; i < count_; i++) {
+            EditCandidate& candidate = candidates_[i];
+            candidate.found_ = false;
+            if (candidate.position_ >= walkable)
+                continue;
+            const char next = Data(candidate)[candidate.position_];
+            if ((candidate.kind_ == EditCandidate::INSERTION || candidate.kind_ == EditCandidate::SUBSTITUTION) &&
+                (next_chars_[candidate.position_] & (1u << (next - 'a'))) == 0)
+                continue;
+            state = prefix_states_[candidate.position_];
+            candidate.found_ = dictionary.Walk(state, Data(candidate) + candidate.position_,
+                                               candidate.length_ - candidate.position_) && state.final_;
+            found += candidate.found_;
+        }
+        return found;
+    }
+
+    // Returns the number of distinct candidates.
+    size_t Count() const {
+        return count_;
+    }
+
+    // Returns candidate i, in generation order.
+    const EditCandidate& operator[](size_t i) const {
+        return candidates_[i];
+    }
+
+    // Returns the chars of candidate, which are not null terminated.
+    const char* Data(const EditCandidate& candidate) const {
+        return buffer_.data() + candidate.offset_;
+    }
+
+private:
+    // Generate substitutions.
+    bool substitutions_;
+    // The word the candidates are edits of.
+    std::string word_;
+    // Candidate chars, back to back.
+    std::vector<char> buffer_;
+    // Chars of buffer_ in use.
+    size_t buffer_used_ = 0;
+    // Candidates; the first count_ are in use.
+    std::vector<EditCandidate> candidates_;
+    size_t count_ = 0;
+    // Open addressing set of the candidates, holding their indexes. A slot is in
+    // use if its stamp is the current stamp_, so clearing the set is one increment.
+    std::vector<uint32_t> set_indexes_;
+    std::vector<uint32_t> set_stamps_;
+    uint32_t stamp_ = 0;
+    // A candidate being looked up in a dictionary.
+    std::string scratch_;
+    // DAWG states after each prefix of the word.
+    std::vector<DawgDictionary::State> prefix_states_;
+    // Chars a-z that can follow each prefix of the word, one bit per char.
+    std::vector<uint32_t> next_chars_;
+
+    // Grows the buffers to hold the candidates of a word of length chars.
+    void Reserve(size_t length) {
+        const size_t max_count = 26 * (length + 1) + length + length + 26 * length;
+        if (candidates_.size() >= max_count)
+            return;
+
+        candidates_.resize(max_count);
+        buffer_.resize(max_count * (length + 1));
+        size_t set_size = 1;
+        while (set_size < 2 * max_count)
+            set_size *= 2;
+        set_indexes_.assign(set_size, 0);
+        set_stamps_.assign(set_size, 0);
+        stamp_ = 0;
+        scratch_.reserve(length + 1);
+        word_.reserve(length);
+    }
+
+    // Starts a new set for the candidates of a word.
+    void NextStamp() {
+        if (++stamp_ == 0) {
+            std::fill(set_stamps_.begin(), set_stamps_.end(), 0);
+            stamp_ = 1;
+        }
+    }
+
+    // Returns where the next candidate's chars go.
+    char* Start() {
+        return buffer_.data() + buffer_used_;
+    }
+
+    // Keeps the candidate written at Start() unless it was generated before.
+    void Add(EditCandidate::Kind kind, size_t position, size_t length) {
+        const char* chars = buffer_.data() + buffer_used_;
+        uint32_t hash = 2166136261u;   // FNV-1a.
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (unsigned char)chars[i]) * 16777619u;
+
+        const size_t mask = set_stamps_.size() - 1;
+        size_t slot = hash & mask;
+        while (set_stamps_[slot] == stamp_) {
+            const EditCandidate& other = candidates_[set_indexes_[slot]];
+            if (other.length_ == length && std::memcmp(Data(other), chars, length) == 0)
+                return;
+            slot = (slot + 1) & mask;
+        }
+        set_stamps_[slot] = stamp_;
+        set_indexes_[slot] = (uint32_t)count_;
+
+        candidates_[count_++] = EditCandidate{ kind, false, (uint32_t)position, (uint32_t)buffer_used_, (uint32_t)length };
+        buffer_used_ += length;
+    }
+};
+
+#endif  // EDIT_CANDIDATES_H
@@ -0,0 +1,58 @@
+// William Yang
+// flag_parsing.h: Validating parsers for the numeric values of command line flags.
+
+#ifndef FLAG_PARSING_H
+#define FLAG_PARSING_H
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+
+// @flag: the flag, for the error message
+// @value: the text after the flag's '='
+// Returns value as an unsigned 64-bit integer (a count or a seed); prints a
+// usage error and exits if it is not a non-negative integer that fits.
+inline unsigned long long ParseUnsignedFlag(const std::string& flag, const std::string& value) {
+    size_t parsed = 0;
+    unsigned long long number = 0;
+    try {
+        // stoull() would skip leading spaces and wrap a minus sign around.
+        if (!value.empty() && std::isdigit((unsigned char)value[0]))
+            number = std::stoull(value, &parsed);
+    }
+    catch (const std::invalid_argument&) { }
+    catch (const std::out_of_range&) { }
+    if (parsed == 0 || parsed != value.size()) {
+        std::cerr << "Invalid value in " << flag << ": expected a non-negative integer." << std::endl;
+        std::exit(1);
+    }
+    return number;
+}
+
+// @flag: the flag, for the error message
+// @value: the text after the flag's '='
+// @low, @high: the range value must be in
+// Returns value as a number; prints a usage error and exits if it is not a
+// number between low and high.
+inline double ParseRealFlag(const std::string& flag, const std::string& value, double low, double high) {
+    size_t parsed = 0;
+    double number = 0;
+    try {
+        if (!value.empty() && !std::isspace((unsigned char)value[0]))
+            number = std::stod(value, &parsed);
+    }
+    catch (const std::invalid_argument&) { }
+    catch (const std::out_of_range&) { }
+    if (parsed == 0 || parsed != value.size() || !(number >= low && number <= high)) {
+        std::cerr << "Invalid value in " << flag << ": expected a number from " << low << " to " << high << "." << std::endl;
+        std::exit(1);
+    }
+    return number;
+}
+
+#endif  // FLAG_PARSING_H
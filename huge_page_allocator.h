@@ -0,0 +1,148 @@
+// William Yang
+// huge_page_allocator.h: An allocator that backs large arrays with 2MB huge pages.
+
+#ifndef HUGE_PAGE_ALLOCATOR_H
+#define HUGE_PAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+
+
+// Size of a huge page (x86-64 and the common arm64 configuration).
+const size_t kHugePageSize = size_t(2) << 20;
+
+// Returns bytes rounded up to a whole number of huge pages.
+inline size_t RoundUpToHugePages(size_t bytes) {
+    return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+// Returns bytes of memory for an array.
+// Arrays smaller than a huge page come from operator new. Larger ones are
+// mapped with explicit huge pages (MAP_HUGETLB) when the system has some
+// reserved, and otherwise mapped 2MB aligned and advised for transparent huge
+// pages (MADV_HUGEPAGE), which the kernel may or may not grant.
+// Throws std::bad_alloc if no memory can be mapped.
+inline void* AllocateHugePages(size_t bytes) {
+    if (bytes < kHugePageSize)
+        return ::operator new(bytes);
+#if defined(__linux__)
+    const size_t length = RoundUpToHugePages(bytes);
+#if defined(MAP_HUGETLB)
+    void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED)
+        return memory;
+#endif
+
+    // Map a huge page more than needed and trim it to a 2MB aligned range,
+    // since transparent huge pages only back aligned 2MB ranges.
+    void* mapped = mmap(nullptr, length + kHugePageSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        throw std::bad_alloc();
+    char* start = static_cast<char*>(mapped);
+    char* aligned = reinterpret_cast<char*>(RoundUpToHugePages(reinterpret_cast<uintptr_t>(start)));
+    if (aligned > start)
+        munmap(start, aligned - start);
+    const size_t tail = (start + length + kHugePageSize) - (aligned + length);
+    if (tail > 0)
+        munmap(aligned + length, tail);
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, length, MADV_HUGEPAGE);   // Fails if transparent huge pages are off; pages stay small.
+#endif
+    return aligned;
+#else
+    return ::operator new(bytes);
+#endif
+}
+
+// Frees memory of bytes bytes from AllocateHugePages().
+inline void DeallocateHugePages(void* memory, size_t bytes) {
+    if (bytes < kHugePageSize) {
+        ::operator delete(memory);
+        return;
+    }
+#if defined(__linux__)
+    munmap(memory, RoundUpToHugePages(bytes));
+#else
+    ::operator delete(memory);
+#endif
+}
+
+// Huge page memory of the process, as reported by Linux.
+struct HugePageUsage {
+    // Kilobytes of explicit huge pages mapped (HugetlbPages of /proc/self/status).
+    size_t hugetlb_kb_ = 0;
+    // Kilobytes of anonymous memory backed by transparent huge pages
+    // (AnonHugePages of /proc/self/smaps_rollup).
+    size_t transparent_kb_ = 0;
+};
+
+// Returns the value in kB of the line starting with field in filename, 0 if there is none.
+inline size_t ReadProcKilobytes(const std::string& filename, const std::string& field) {
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line))
+        if (line.compare(0, field.size(), field) == 0)
+            return std::stoull(line.substr(field.size()));
+    return 0;
+}
+
+// Returns the huge page memory of the process; zeros where it cannot be read.
+inline HugePageUsage CurrentHugePageUsage() {
+    HugePageUsage usage;
+    usage.hugetlb_kb_ = ReadProcKilobytes("/proc/self/status", "HugetlbPages:");
+    usage.transparent_kb_ = ReadProcKilobytes("/proc/self/smaps_rollup", "AnonHugePages:");
+    return usage;
+}
+
+// Class HugePageAllocator:
+// A stateless allocator for the slot arrays of the hash tables.
+// Random probes into a large table touch a new page almost every time; with
+// 2MB pages instead of 4KB ones, a TLB entry covers 512 times as many slots.
+// Arrays under a huge page are allocated normally, so small tables do not
+// take 2MB each.
+template <typename T>
+class HugePageAllocator {
+public:
+    using value_type = T;
+
+    // Constructors for the allocator, which has no state.
+    HugePageAllocator() noexcept { }
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept { }
+
+    // Returns uninitialized memory for n objects.
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(AllocateHugePages(n * sizeof(T)));
+    }
+
+    // Frees memory for n objects from allocate().
+    void deallocate(T* memory, size_t n) noexcept {
+        DeallocateHugePages(memory, n * sizeof(T));
+    }
+};
+
+// Huge page allocators are interchangeable.
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) {
+    return false;
+}
+
+#endif  // HUGE_PAGE_ALLOCATOR_H
@@ -0,0 +1,254 @@
+// William Yang
+// inline_key.h: A 16-byte string key that stores short words inline.
+
+#ifndef INLINE_KEY_H
+#define INLINE_KEY_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "seeded_hash.h"
+
+
+
+// Class InlineKey:
+// A string key packed into two 64-bit words.
+// Keys of up to 15 chars are stored inline, zero padded, with their length in
+// the last byte, so two inline keys are equal exactly when both words are equal.
+// Longer keys hold a pointer and length; the last byte marks them as long.
+// A long key owns a heap copy of its bytes, freed with the key, so a table
+// gives them back when it is emptied or destroyed. Borrow() makes a key that
+// refers to the caller's bytes instead, for lookups (see LookupKey()). Copying
+// a borrowed key copies the bytes, so keys a hash table inserts by const
+// reference never refer to the caller's string. Moving one keeps it borrowed,
+// which keeps moves noexcept: a borrowed key must not be moved into a table.
+class InlineKey {
+public:
+    // Longest key stored inline.
+    static const size_t kInlineCapacity = 15;
+
+    // Default constructor for key, the empty string.
+    InlineKey() : words_{ 0, 0 } { }
+
+    // Constructor for key holding a copy of the length bytes at data.
+    InlineKey(const char* data, size_t length) : words_{ 0, 0 } {
+        if (length <= kInlineCapacity) {
+            std::memcpy(Bytes(), data, length);
+            Bytes()[kTagByte] = (char)length;
+        } else {
+            SetLong(CopyBytes(data, length), length, kOwned);
+        }
+    }
+
+    // Constructor for key holding a copy of the chars of word.
+    explicit InlineKey(const std::string& word) : InlineKey(word.data(), word.size()) { }
+
+    // Returns a key for the length bytes at data that borrows them, if there
+    // are too many to store inline, instead of copying them. The bytes must
+    // outlive the key.
+    static InlineKey Borrow(const char* data, size_t length) {
+        if (length <= kInlineCapacity)
+            return InlineKey(data, length);
+        return InlineKey(data, length, kBorrowed);
+    }
+
+    // Returns a key borrowing the chars of word, which must outlive the key.
+    static InlineKey Borrow(const std::string& word) {
+        return Borrow(word.data(), word.size());
+    }
+    static InlineKey Borrow(std::string&& word) = delete;
+
+    // Copy constructor for key.
+    // Long keys get their own copy of the bytes.
+    InlineKey(const InlineKey& other) : words_{ other.words_[0], other.words_[1] } {
+        if (!IsInline())
+            SetLong(CopyBytes(data(), size()), size(), kOwned);
+    }
+
+    // Move constructor for key.
+    // Takes the bytes of an owning long key, leaving other empty; a borrowed
+    // key stays borrowed.
+    InlineKey(InlineKey&& other) noexcept : words_{ other.words_[0], other.words_[1] } {
+        if (Tag() == kOwned) {
+            other.words_[0] = 0;
+            other.words_[1] = 0;
+        }
+    }
+
+    // Destructor for key, freeing the bytes a long key owns.
+    ~InlineKey() {
+        if (Tag() == kOwned)
+            delete[] data();
+    }
+
+    // Copy assignment for key.
+    InlineKey& operator=(const InlineKey& other) {
+        InlineKey copy(other);
+        swap(*this, copy);
+        return *this;
+    }
+
+    // Move assignment for key.
+    InlineKey& operator=(InlineKey&& other) noexcept {
+        InlineKey moved(std::move(other));
+        swap(*this, moved);
+        return *this;
+    }
+
+    // Exchanges two keys, including whether their bytes are owned or borrowed.
+    friend void swap(InlineKey& a, InlineKey& b) noexcept {
+        std::swap(a.words_[0], b.words_[0]);
+        std::swap(a.words_[1], b.words_[1]);
+    }
+
+    // Returns true if the key is stored inline.
+    bool IsInline() const {
+        return (unsigned char)Tag() <= kInlineCapacity;
+    }
+
+    // Returns true if the key is long and borrows its bytes (see Borrow()).
+    bool IsBorrowed() const {
+        return Tag() == kBorrowed;
+    }
+
+    // Returns the number of chars in the key.
+    size_t size() const {
+        if (IsInline())
+            return (unsigned char)Tag();
+        uint32_t length;
+        std::memcpy(&length, Bytes() + sizeof(const char*), sizeof(length));
+        return length;
+    }
+
+    // Returns the chars of the key (not null terminated).
+    const char* data() const {
+        if (IsInline())
+            return Bytes();
+        const char* long_data;
+        std::memcpy(&long_data, Bytes(), sizeof(long_data));
+        return long_data;
+    }
+
+    // Returns the key as a string.
+    std::string ToString() const {
+        return std::string(data(), size());
+    }
+
+    // Returns the two words holding the key, used for hashing inline keys.
+    uint64_t Word(size_t i) const {
+        return words_[i];
+    }
+
+    // Returns the 16 bytes holding the key.
+    const char* RawBytes() const {
+        return Bytes();
+    }
+
+    friend bool operator==(const InlineKey& a, const InlineKey& b) {
+        if (a.words_[0] == b.words_[0] && a.words_[1] == b.words_[1])
+            return true;
+        // Inline keys differ from every other key, long keys never equal inline keys.
+        if (a.IsInline() || b.IsInline())
+            return false;
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+
+    friend bool operator!=(const InlineKey& a, const InlineKey& b) {
+        return !(a == b);
+    }
+
+private:
+    // Index of the byte holding the inline length or the long key tag.
+    static const size_t kTagByte = 15;
+    // Tag of a long key that owns its bytes.
+    static const char kOwned = (char)0xFF;
+    // Tag of a long key whose bytes belong to the caller (see Borrow()).
+    static const char kBorrowed = (char)0xFE;
+
+    // The key, viewed as bytes through Bytes().
+    uint64_t words_[2];
+
+    // Constructor for a long key referring to the length bytes at data, with the given tag.
+    InlineKey(const char* data, size_t length, char tag) : words_{ 0, 0 } {
+        SetLong(data, length, tag);
+    }
+
+    // Returns a heap copy of the length bytes at data, freed by the destructor.
+    static const char* CopyBytes(const char* data, size_t length) {
+        char* copy = new char[length];
+        std::memcpy(copy, data, length);
+        return copy;
+    }
+
+    char* Bytes() {
+        return reinterpret_cast<char*>(words_);
+    }
+
+    const char* Bytes() const {
+        return reinterpret_cast<const char*>(words_);
+    }
+
+    char Tag() const {
+        return Bytes()[kTagByte];
+    }
+
+    // Stores a long key: the pointer, then the 32-bit length, then the tag.
+    void SetLong(const char* data, size_t length, char tag) {
+        uint32_t length32 = (uint32_t)length;
+        words_[0] = 0;
+        words_[1] = 0;
+        std::memcpy(Bytes(), &data, sizeof(data));
+        std::memcpy(Bytes() + sizeof(data), &length32, sizeof(length32));
+        Bytes()[kTagByte] = tag;
+    }
+};
+
+// Returns the seeded hash value of a key: SipHash-1-3 of its 16 bytes when it is
+// inline, of its chars when it is long.
+inline uint64_t SeededHashValue(const InlineKey& x, const HashKey& key) {
+    if (x.IsInline())
+        return SipHash13(key.k0_, key.k1_, x.RawBytes(), 16);
+    return SipHash13(key.k0_, key.k1_, x.data(), x.size());
+}
+
+// Returns the bytes a key owns outside its 16 bytes: the heap copy of its chars
+// when it is long, none when it is inline or borrows its chars.
+inline size_t KeyHeapBytes(const InlineKey& x) {
+    return x.IsInline() || x.IsBorrowed() ? 0 : x.size();
+}
+
+namespace std {
+
+// Hash function for InlineKey.
+// Inline keys mix their two words; long keys hash their bytes (FNV-1a).
+template <>
+struct hash<InlineKey> {
+    size_t operator()(const InlineKey& key) const {
+        uint64_t h;
+        if (key.IsInline()) {
+            h = key.Word(0) * 0x9E3779B97F4A7C15ULL;
+            h ^= (key.Word(1) + (h >> 29)) * 0xC2B2AE3D27D4EB4FULL;
+        } else {
+            h = 0xCBF29CE484222325ULL;
+            const char* data = key.data();
+            for (size_t i = 0; i < key.size(); i++) {
+                h ^= (unsigned char)data[i];
+                h *= 0x100000001B3ULL;
+            }
+        }
+        // Final avalanche (MurmurHash3 fmix64).
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB93FE1A85EC3ULL;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+};
+
+}  // namespace std
+
+#endif  // INLINE_KEY_H
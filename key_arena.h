@@ -0,0 +1,250 @@
+// William Yang
+// key_arena.h: A monotonic arena for the chars of string keys, released in bulk.
+
+#ifndef KEY_ARENA_H
+#define KEY_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <scoped_allocator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "seeded_hash.h"
+
+
+
+// Class MonotonicArena:
+// Memory handed out by bumping a pointer through large chunks. Nothing is freed
+// on its own; Release() or the destructor frees every chunk at once. Keys that
+// are only ever inserted then dropped together cost no malloc() or free() each
+// and end up next to each other. Not thread safe, like the tables.
+// Arenas are owned by shared_ptr: each table whose keys use one holds a share.
+class MonotonicArena : public std::enable_shared_from_this<MonotonicArena> {
+public:
+    // Default size of each chunk of arena storage.
+    static const size_t kDefaultChunkSize = 64 * 1024;
+
+    // Constructor for an empty arena that allocates chunk_size bytes at a time.
+    explicit MonotonicArena(size_t chunk_size = kDefaultChunkSize) : chunk_size_(chunk_size) { }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    // Returns bytes of memory aligned to alignment, a power of two of at most
+    // alignof(std::max_align_t), valid until Release() or destruction.
+    void* Allocate(size_t bytes, size_t alignment) {
+        size_t padding = Padding(alignment);
+        if (bytes + padding > remaining_) {
+            size_t size = chunk_size_;
+            if (bytes > size)
+                size = bytes;
+            chunks_.emplace_back(new char[size]);
+            next_ = chunks_.back().get();
+            remaining_ = size;
+            bytes_ += size;
+            padding = 0;
+        }
+        char* memory = next_ + padding;
+        next_ = memory + bytes;
+        remaining_ -= padding + bytes;
+        used_bytes_ += bytes;
+        return memory;
+    }
+
+    // Frees every chunk. Nothing allocated from the arena may be used afterwards.
+    void Release() {
+        chunks_.clear();
+        next_ = nullptr;
+        remaining_ = 0;
+        bytes_ = 0;
+        used_bytes_ = 0;
+    }
+
+    // Returns the bytes of the chunks held.
+    size_t Bytes() const {
+        return bytes_;
+    }
+
+    // Returns the bytes handed out since the last Release().
+    size_t UsedBytes() const {
+        return used_bytes_;
+    }
+
+    // Returns the size of each chunk.
+    size_t ChunkSize() const {
+        return chunk_size_;
+    }
+
+private:
+    // Size of each chunk; larger allocations get a chunk of their own size.
+    size_t chunk_size_;
+    // Chunks of arena storage.
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    // Next free byte in the last chunk.
+    char* next_ = nullptr;
+    // Free bytes left in the last chunk.
+    size_t remaining_ = 0;
+    // Bytes of the chunks.
+    size_t bytes_ = 0;
+    // Bytes handed out.
+    size_t used_bytes_ = 0;
+
+    // Returns the bytes to skip for next_ to be aligned to alignment.
+    size_t Padding(size_t alignment) const {
+        return (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+    }
+};
+
+// Class ArenaAllocator:
+// Allocates from a MonotonicArena; deallocating does nothing. The allocator
+// only points at the arena, so the strings allocated from it stay a pointer
+// larger than std::string and copying one costs no reference count; the slots
+// of the table hold the arena (see AllocatorMemoryOwner()).
+// A default constructed allocator has no arena and uses operator new and
+// delete instead, so keys made outside a table (for example to look one up)
+// do not grow any arena. Like std::pmr::polymorphic_allocator, the arena does
+// not follow a copied container: a copy selects an allocator without arena.
+// It does follow a container moved or swapped, whose memory it refers to.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    // Constructor for an allocator without arena.
+    ArenaAllocator() noexcept : arena_(nullptr) { }
+
+    // Constructor for an allocator from arena. The tables given the allocator
+    // take a share of arena when they are constructed; until then, and for
+    // anything else allocated, the caller keeps it alive.
+    explicit ArenaAllocator(const std::shared_ptr<MonotonicArena>& arena) noexcept : arena_(arena.get()) { }
+
+    // Constructor for an allocator sharing the arena of other.
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.Arena()) { }
+
+    // Returns uninitialized memory for n objects.
+    T* allocate(size_t n) {
+        if (arena_ == nullptr)
+            return std::allocator<T>().allocate(n);
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Frees memory for n objects from allocate(); arena memory waits for Release().
+    void deallocate(T* memory, size_t n) noexcept {
+        if (arena_ == nullptr)
+            std::allocator<T>().deallocate(memory, n);
+    }
+
+    // Returns the allocator of a copied container: one without arena.
+    ArenaAllocator select_on_container_copy_construction() const {
+        return ArenaAllocator();
+    }
+
+    // Returns the arena, null if there is none.
+    MonotonicArena* Arena() const {
+        return arena_;
+    }
+
+private:
+    // The arena allocated from, or null for operator new.
+    MonotonicArena* arena_;
+};
+
+// Arena allocators are interchangeable if they allocate from the same arena.
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.Arena() == b.Arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.Arena() != b.Arena();
+}
+
+// Class ArenaString:
+// A string whose chars come from an ArenaAllocator. Converts implicitly from
+// std::string (without arena), so it can be looked up and inserted like one.
+// Constructed with an allocator, it copies its chars into that allocator's arena
+// unless they are already there.
+class ArenaString : public std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> {
+public:
+    using Base = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+    using Base::Base;
+
+    // Constructor for an empty string without arena.
+    ArenaString() { }
+
+    // Constructor for a copy of x without arena.
+    ArenaString(const std::string& x) : Base(x.data(), x.size()) { }
+
+    // Copy and move constructors, keeping the allocator of x.
+    ArenaString(const ArenaString& x) = default;
+    ArenaString(ArenaString&& x) = default;
+
+    // Copy and move constructors with the given allocator, used by containers
+    // passing their allocator down (std::scoped_allocator_adaptor).
+    ArenaString(const ArenaString& x, const allocator_type& allocator) : Base(x, allocator) { }
+    ArenaString(ArenaString&& x, const allocator_type& allocator) : Base(std::move(x), allocator) { }
+
+    ArenaString& operator=(const ArenaString& x) = default;
+    ArenaString& operator=(ArenaString&& x) = default;
+
+    // Exchanges the chars of two strings with equal allocators.
+    friend void swap(ArenaString& a, ArenaString& b) noexcept {
+        a.Base::swap(b);
+    }
+};
+
+// Returns the seeded hash value of an arena string, equal to that of the same std::string.
+inline uint64_t SeededHashValue(const ArenaString& x, const HashKey& key) {
+    return SipHash13(key.k0_, key.k1_, x.data(), x.size());
+}
+
+// Returns the bytes an arena string owns outside itself: none if its chars fit
+// in the string (small string optimization), otherwise its capacity and terminator.
+inline size_t KeyHeapBytes(const ArenaString& x) {
+    const char* object = reinterpret_cast<const char*>(&x);
+    if (x.data() >= object && x.data() < object + sizeof(x))
+        return 0;
+    return x.capacity() + 1;
+}
+
+// Allocator of a table of ArenaString keys: slots come from SlotAllocator and
+// the keys' chars from the arena given as the inner allocator, e.g.
+// ArenaKeyAllocator<ArenaString>(std::allocator<ArenaString>(),
+//                                ArenaAllocator<char>(arena)), where arena is a shared_ptr<MonotonicArena>.
+// Slot arrays stay out of the arena, since every rehash would leave the old one there.
+template <typename HashedObj, typename SlotAllocator = std::allocator<HashedObj>>
+using ArenaKeyAllocator = std::scoped_allocator_adaptor<SlotAllocator, ArenaAllocator<char>>;
+
+// Returns a share of the key arena of a table's allocator, held by its slots.
+template <typename SlotAllocator, typename T>
+std::shared_ptr<void> AllocatorMemoryOwner(const std::scoped_allocator_adaptor<SlotAllocator, ArenaAllocator<T>>& allocator) {
+    MonotonicArena* arena = allocator.inner_allocator().Arena();
+    if (arena == nullptr)
+        return nullptr;
+    return arena->shared_from_this();
+}
+
+// Gives back the key memory of a table's allocator once the table holds no
+// keys, which MakeEmpty() does: if its arena has been allocated from, the table
+// moves on to a new one, and the old arena is freed when no other share of it
+// (such as another table given the same arena) is left.
+template <typename SlotAllocator, typename T>
+void ReleaseAllocatorMemory(std::scoped_allocator_adaptor<SlotAllocator, ArenaAllocator<T>>& allocator,
+                            std::shared_ptr<void>& owner) {
+    const MonotonicArena* arena = allocator.inner_allocator().Arena();
+    if (arena != nullptr && arena->UsedBytes() > 0) {
+        std::shared_ptr<MonotonicArena> fresh = std::make_shared<MonotonicArena>(arena->ChunkSize());
+        allocator.inner_allocator() = ArenaAllocator<T>(fresh);
+        owner = std::move(fresh);
+    }
+}
+
+#endif  // KEY_ARENA_H
@@ -0,0 +1,211 @@
+// William Yang
+// layered_dictionary.h: A dictionary made of an immutable base hash table plus
+// named overlay hash tables that can be replaced while readers are checking words.
+
+#ifndef LAYERED_DICTIONARY_H
+#define LAYERED_DICTIONARY_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "double_hashing.h"
+
+
+
+// Class LayeredDictionary:
+// A word is in the dictionary if it is in the base table or in any overlay table.
+// The tables are never modified once published; an update builds a new snapshot
+// that shares the unchanged tables and swaps it in with a single pointer store
+// (read-copy-update). Readers never take a lock: Read() pins the current snapshot
+// with one atomic increment, and a writer frees a replaced snapshot only after all
+// readers that may still see it have released their pin. Writers wait for those
+// readers; readers never wait for writers.
+template <typename HashedObj, typename BaseTable = HashTableDouble<HashedObj>,
+          typename OverlayTable = BaseTable>
+class LayeredDictionary {
+public:
+    // Immutable view of the base table and overlay tables at one point in time.
+    class Snapshot {
+    public:
+        // Check if x is in the base table or any overlay table.
+        bool Contains(const HashedObj& x) const {
+            if (base_->Contains(x))
+                return true;
+            for (const auto& overlay : overlays_)
+                if (overlay.second->Contains(x))
+                    return true;
+            return false;
+        }
+
+        // Returns the number of overlay tables.
+        size_t OverlayCount() const {
+            return overlays_.size();
+        }
+
+        // Returns the version of this snapshot, incremented by every update.
+        size_t Version() const {
+            return version_;
+        }
+
+    private:
+        friend class LayeredDictionary;
+
+        // The base table.
+        std::shared_ptr<const BaseTable> base_;
+        // Overlay tables with their names, in the order they were added.
+        std::vector<std::pair<std::string, std::shared_ptr<const OverlayTable>>> overlays_;
+        // Version of this snapshot.
+        size_t version_ = 0;
+    };
+
+    // Pin on a snapshot, returned by Read().
+    // The snapshot stays valid until the Reader is destroyed.
+    class Reader {
+    public:
+        Reader(Reader&& other) : pin_(other.pin_), snapshot_(other.snapshot_) {
+            other.pin_ = nullptr;
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // Releases the pin on the snapshot.
+        ~Reader() {
+            if (pin_ != nullptr)
+                pin_->fetch_sub(1);
+        }
+
+        const Snapshot& operator*() const {
+            return *snapshot_;
+        }
+
+        const Snapshot* operator->() const {
+            return snapshot_;
+        }
+
+    private:
+        friend class LayeredDictionary;
+
+        Reader(std::atomic<size_t>* pin, const Snapshot* snapshot)
+            : pin_(pin), snapshot_(snapshot) { }
+
+        // Reader counter of the epoch the snapshot was pinned in.
+        std::atomic<size_t>* pin_;
+        // The pinned snapshot.
+        const Snapshot* snapshot_;
+    };
+
+    // Constructor for layered dictionary.
+    // Starts with base as the only table.
+    explicit LayeredDictionary(std::shared_ptr<const BaseTable> base) {
+        Snapshot* first = new Snapshot;
+        first->base_ = std::move(base);
+        current_.store(first);
+        readers_[0].store(0);
+        readers_[1].store(0);
+    }
+
+    LayeredDictionary(const LayeredDictionary&) = delete;
+    LayeredDictionary& operator=(const LayeredDictionary&) = delete;
+
+    // Frees the current snapshot.
+    // No Reader may outlive the dictionary.
+    ~LayeredDictionary() {
+        delete current_.load();
+    }
+
+    // Pins and returns the current snapshot.
+    // Never blocks, even while an update is being published.
+    Reader Read() const {
+        std::atomic<size_t>& pin = readers_[epoch_.load() & 1];
+        pin.fetch_add(1);
+        return Reader(&pin, current_.load());
+    }
+
+    // Check if x is in the current snapshot.
+    bool Contains(const HashedObj& x) const {
+        return Read()->Contains(x);
+    }
+
+    // Returns the version of the current snapshot.
+    size_t Version() const {
+        return Read()->Version();
+    }
+
+    // Replaces the base table.
+    // Waits until no reader can see the replaced snapshot.
+    void SetBase(std::shared_ptr<const BaseTable> base) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        Snapshot* next = new Snapshot(*current_.load());
+        next->base_ = std::move(base);
+        Publish(next);
+    }
+
+    // Adds overlay under name, or replaces the overlay already under name.
+    // Waits until no reader can see the replaced snapshot.
+    void SetOverlay(const std::string& name, std::shared_ptr<const OverlayTable> overlay) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        Snapshot* next = new Snapshot(*current_.load());
+        bool replaced = false;
+        for (auto& entry : next->overlays_)
+            if (entry.first == name) {
+                entry.second = overlay;
+                replaced = true;
+            }
+        if (!replaced)
+            next->overlays_.emplace_back(name, std::move(overlay));
+        Publish(next);
+    }
+
+    // Removes the overlay under name.
+    // Returns true if successful;
+    // false otherwise.
+    bool RemoveOverlay(const std::string& name) {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        Snapshot* next = new Snapshot(*current_.load());
+        for (auto entry = next->overlays_.begin(); entry != next->overlays_.end(); ++entry)
+            if (entry->first == name) {
+                next->overlays_.erase(entry);
+                Publish(next);
+                return true;
+            }
+        delete next;
+        return false;
+    }
+
+private:
+    // The current snapshot.
+    std::atomic<const Snapshot*> current_;
+    // Incremented on every publish; its low bit selects the reader counter for new pins.
+    mutable std::atomic<size_t> epoch_{ 0 };
+    // Readers pinned during even and odd epochs.
+    mutable std::atomic<size_t> readers_[2];
+    // Serializes writers; readers never touch it.
+    std::mutex writer_mutex_;
+
+    // Makes next the current snapshot and frees the previous one once no reader can see it.
+    // Must be called with writer_mutex_ held, and never by a thread holding a Reader.
+    void Publish(Snapshot* next) {
+        next->version_ = current_.load()->version_ + 1;
+        const Snapshot* previous = current_.exchange(next);
+
+        // Any reader that can still see previous pinned it before the exchange, so it is
+        // counted in one of the two counters. Flip the epoch so new readers count
+        // in the other counter, and wait for the old one to drain; then do the
+        // same for the other counter.
+        for (int i = 0; i < 2; i++) {
+            size_t old_epoch = epoch_.fetch_add(1);
+            while (readers_[old_epoch & 1].load() != 0)
+                std::this_thread::yield();
+        }
+
+        delete previous;
+    }
+};
+
+#endif  // LAYERED_DICTIONARY_H
@@ -1,218 +1,330 @@
-// William Yang
-// linear_probing.h: A hash table with linear probing implementation.
-
-#ifndef LINEAR_PROBING_H
-#define LINEAR_PROBING_H
-
-#include <vector>
-#include <algorithm>
-#include <functional>
-
-
-
-// Class HashTableLinear:
-// A hash table container with linear probing implementation.
-template <typename HashedObj>
-class HashTableLinear {
-public:
-    // Used to determine if hash entries are ACTIVE, EMPTY, or DELETED.
-    enum EntryType { ACTIVE, EMPTY, DELETED };
-
-    // Default constructor for hash table.
-    // Size set to 101 by default, unless specified.
-    // If size is specified and is prime, size is set to the desired number,
-    // otherwise set the size as the next prime number after given number.
-    explicit HashTableLinear(size_t size = 101) : array_(NextPrime(size)) {
-        MakeEmpty();
-    }
-
-    // Check if the hash table contains x.
-    // Return true if x is found;
-    // false otherwise.
-    bool Contains(const HashedObj& x) {
-        return IsActive(FindPos(x));
-    }
-
-    // Clear the hash table.
-    void MakeEmpty() {
-        current_size_ = 0;
-        for (auto& entry : array_)
-            entry.info_ = EMPTY;
-    }
-
-    // Insert x into the hash table.
-    // Returns true if successful;
-    // false otherwise.
-    bool Insert(const HashedObj& x) {
-        size_t current_pos = FindPos(x);
-        if (IsActive(current_pos))  // Failed to insert.
-            return false;
-
-        // Insert x as active.
-        array_[current_pos].element_ = x;
-        array_[current_pos].info_ = ACTIVE;
-
-        // Rehash.
-        if (++current_size_ > array_.size() / 2)
-            Rehash();
-        return true;
-    }
-
-    // Move insert x into the hash table.
-    // Returns true if successful;
-    // false otherwise.
-    bool Insert(HashedObj&& x) {
-        size_t current_pos = FindPos(x);
-        if (IsActive(current_pos))  // Failed to insert.
-            return false;
-
-        // Insert x as active.
-        array_[current_pos] = std::move(x);
-        array_[current_pos].info_ = ACTIVE;
-
-        // Rehash.
-        if (++current_size_ > array_.size() / 2)
-            Rehash();
-
-        return true;
-    }
-
-    // Removes x from the hash table.
-    // Returns true if successful;
-    // false otherwise.
-    bool Remove(const HashedObj& x) {
-        size_t current_pos = FindPos(x);
-        if (!IsActive(current_pos)) // Failed to remove.
-            return false;
-
-        // Removed x, set as deleted.
-        array_[current_pos].info_ = DELETED;
-        return true;
-    }
-
-    // Returns the current size of the hash table.
-    size_t Size() const {
-        return current_size_;
-    }
-
-    // Returns the capacity of the hash table.
-    size_t Capacity() const {
-        return array_.capacity();
-    }
-
-    // Returns the load factor of the hash table.
-    float LoadFactor() const {
-        return (float)current_size_ / array_.capacity();
-    }
-
-    // Returns the total collisions counter.
-    size_t TotalCollisions() const {
-        return collisions_;
-    }
-
-    // Returns the average collisions of total collisions divided by the current size.
-    float AverageCollisions() const {
-        return (float)collisions_ / current_size_;
-    }
-
-    // Return probes used for the latest FindPos() function call.
-    size_t ProbesUsed() const {
-        return probes_used_;
-    }
-
-private:
-    // Hash entry of the hash table.
-    struct HashEntry {
-        // The actual hashed element.
-        HashedObj element_;
-        // The current state of the hash entry (ACTIVE, EMPTY, DELETED).
-        EntryType info_;
-
-        // Constructor for hash entry.
-        HashEntry(const HashedObj& e = HashedObj{}, EntryType i = EMPTY)
-            :element_{ e }, info_{ i } { }
-
-        // Constructor to move hash entry element.
-        HashEntry(HashedObj&& e, EntryType i = EMPTY)
-            :element_{ std::move(e) }, info_{ i } {}
-    };
-
-    // The hash table.
-    std::vector<HashEntry> array_;
-    // Current size of table.
-    size_t current_size_;
-    // Total collisions counter.
-    size_t collisions_ = 0;
-
-    // Check if position in table is ACTIVE (holds an element).
-    bool IsActive(size_t current_pos) const {
-        return array_[current_pos].info_ == ACTIVE;
-    }
-
-    size_t probes_used_;   // To track number of probes used for find (most recent find).
-
-    // Return the position of x.
-    // Counts the number of probes used to find x.
-    // Automatically resets the counter with each call.
-    size_t FindPos(const HashedObj& x) {
-        probes_used_ = 1;
-        size_t current_pos = InternalHash(x);
-
-        while (array_[current_pos].info_ != EMPTY &&
-            array_[current_pos].element_ != x) {
-            probes_used_++;
-            collisions_++;
-            current_pos++;  // Compute ith probe.
-            if (current_pos >= array_.size())   // Wrap around table.
-                current_pos -= array_.size();
-        }
-        return current_pos;
-    }
-
-    // Rehash hash table, table is getting full.
-    void Rehash() {
-        std::vector<HashEntry> old_array = array_;
-
-        // Create new double-sized, empty table.
-        array_.resize(NextPrime(2 * old_array.size()));
-        for (auto& entry : array_)
-            entry.info_ = EMPTY;
-
-        // Copy table over.
-        current_size_ = 0;
-        for (auto& entry : old_array)
-            if (entry.info_ == ACTIVE)
-                Insert(std::move(entry.element_));
-    }
-
-    // Hash function.
-    size_t InternalHash(const HashedObj& x) const {
-        static std::hash<HashedObj> hf;
-        return hf(x) % array_.size();
-    }
-
-    // Internal method to test if a positive number is prime.
-    bool IsPrime(size_t n) {
-        if (n == 2 || n == 3)
-            return true;
-
-        if (n == 1 || n % 2 == 0)
-            return false;
-
-        for (size_t i = 3; i * i <= n; i += 2)
-            if (n % i == 0)
-                return false;
-
-        return true;
-    }
-
-    // Internal method to return a prime number at least as large as n.
-    size_t NextPrime(size_t n) {
-        if (n % 2 == 0)
-            ++n;
-        while (!IsPrime(n)) n += 2;
-        return n;
-    }
-};
-
-#endif  // LINEAR_PROBING_H
+// William Yang
+// linear_probing.h: A hash table with linear probing implementation.
+
+#ifndef LINEAR_PROBING_H
+#define LINEAR_PROBING_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "seeded_hash.h"
+#include "slot_storage.h"
+#include "table_memory.h"
+
+
+
+// Class HashTableLinear:
+// A hash table container with linear probing implementation.
+template <typename HashedObj, typename HashFunc = SeededHash<HashedObj>,
+          typename Allocator = std::allocator<HashedObj>>
+class HashTableLinear {
+public:
+    // Used to determine if hash entries are ACTIVE, EMPTY, or DELETED.
+    enum EntryType { ACTIVE, EMPTY, DELETED };
+
+    // Default constructor for hash table.
+    // Size set to 101 by default, unless specified.
+    // If size is specified and is prime, size is set to the desired number,
+    // otherwise set the size as the next prime number after given number.
+    // Hash function seeded with DefaultHashSeed() by default, unless specified.
+    // Slot memory comes from allocator.
+    explicit HashTableLinear(size_t size = 101, const HashFunc& hash_function = HashFunc{},
+                             const Allocator& allocator = Allocator{})
+        : array_(NextPrime(size), allocator), hash_function_(hash_function) {
+        MakeEmpty();
+    }
+
+    // Check if the hash table contains x.
+    // Return true if x is found;
+    // false otherwise.
+    bool Contains(const HashedObj& x) {
+        return IsActive(FindPos(x, Hash(x)));
+    }
+
+    // Check if the hash table contains x without updating the probe and
+    // collision counters, so that concurrent readers can share a const table.
+    bool Contains(const HashedObj& x) const {
+        return IsActive(FindPos(x, Hash(x)));
+    }
+
+    // Clear the hash table.
+    // Under an enabled shrink policy, also gives the slots back down to its minimum capacity.
+    // Memory the allocator holds for the keys, such as a key arena, is released.
+    void MakeEmpty() {
+        current_size_ = 0;
+        tombstones_ = 0;
+        low_load_removes_ = 0;
+        if (shrink_policy_.enabled_ && array_.size() > NextPrime(shrink_policy_.min_capacity_)) {
+            array_ = SlotStorage<HashedObj, Allocator>(NextPrime(shrink_policy_.min_capacity_), array_.GetAllocator());
+        } else {
+            array_.Clear();
+        }
+        array_.ReleaseElementMemory();
+    }
+
+    // Insert x into the hash table.
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(const HashedObj& x) {
+        size_t current_pos = FindPos(x, Hash(x));
+        if (IsActive(current_pos))  // Failed to insert.
+            return false;
+
+        // Insert x as active.
+        array_.Construct(current_pos, x);
+
+        // Rehash.
+        if (++current_size_ + tombstones_ > array_.size() / 2)
+            Rehash(GrowSize());
+        return true;
+    }
+
+    // Move insert x into the hash table.
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(HashedObj&& x) {
+        return Insert(std::move(x), Hash(x));
+    }
+
+    // Move insert x into the hash table, given its hash value from Hash().
+    // Lets callers hash elements ahead of time (for example on other threads).
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(HashedObj&& x, size_t hash_value) {
+        size_t current_pos = FindPos(x, hash_value);
+        if (IsActive(current_pos))  // Failed to insert.
+            return false;
+
+        // Insert x as active.
+        array_.Construct(current_pos, std::move(x));
+
+        // Rehash.
+        if (++current_size_ + tombstones_ > array_.size() / 2)
+            Rehash(GrowSize());
+
+        return true;
+    }
+
+    // Removes x from the hash table.
+    // Returns true if successful;
+    // false otherwise.
+    bool Remove(const HashedObj& x) {
+        size_t current_pos = FindPos(x, Hash(x));
+        if (!IsActive(current_pos)) // Failed to remove.
+            return false;
+
+        // Removed x, set as deleted.
+        array_.Destroy(current_pos, DELETED);
+        current_size_--;
+        tombstones_++;
+        ShrinkIfSparse();
+        return true;
+    }
+
+    // Returns the current size of the hash table.
+    size_t Size() const {
+        return current_size_;
+    }
+
+    // Returns the capacity of the hash table.
+    size_t Capacity() const {
+        return array_.size();
+    }
+
+    // Returns the load factor of the hash table.
+    float LoadFactor() const {
+        return (float)current_size_ / array_.size();
+    }
+
+    // Returns the total collisions counter.
+    size_t TotalCollisions() const {
+        return collisions_;
+    }
+
+    // Returns the average collisions of total collisions divided by the current size.
+    float AverageCollisions() const {
+        return (float)collisions_ / current_size_;
+    }
+
+    // Return probes used for the latest FindPos() function call.
+    size_t ProbesUsed() const {
+        return probes_used_;
+    }
+
+    // Returns the hash value of x used to place it in the table.
+    size_t Hash(const HashedObj& x) const {
+        return hash_function_(x);
+    }
+
+    // Returns the hash function of the table.
+    const HashFunc& HashFunction() const {
+        return hash_function_;
+    }
+
+    // Grows the table to the capacity it would reach after n insertions,
+    // so that inserting up to n elements does not rehash.
+    void Reserve(size_t n) {
+        size_t new_size = array_.size();
+        while (n > new_size / 2)
+            new_size = NextPrime(2 * new_size);
+        if (new_size > array_.size())
+            Rehash(new_size);
+    }
+
+    // Returns the number of DELETED slots, which are cleared by the next rehash.
+    size_t Tombstones() const {
+        return tombstones_;
+    }
+
+    // Returns the memory footprint of the table: its slot array, the heap
+    // bytes owned by its keys, and its tombstones.
+    TableMemoryUsage MemoryUsage() const {
+        TableMemoryUsage usage;
+        usage.slots_ = array_.size();
+        usage.slot_bytes_ = array_.Bytes();
+        usage.active_ = current_size_;
+        usage.tombstones_ = tombstones_;
+        for (size_t i = 0; i < array_.size(); i++)
+            if (IsActive(i))
+                usage.key_heap_bytes_ += KeyHeapBytes(array_.Element(i));
+        return usage;
+    }
+
+    // Sets when the table shrinks after elements are removed (never, by default).
+    void SetShrinkPolicy(const ShrinkPolicy& policy) {
+        shrink_policy_ = policy;
+        low_load_removes_ = 0;
+    }
+
+    // Returns the shrink policy of the table.
+    const ShrinkPolicy& GetShrinkPolicy() const {
+        return shrink_policy_;
+    }
+
+    // Returns the allocator of the slots.
+    Allocator GetAllocator() const {
+        return Allocator(array_.GetAllocator());
+    }
+
+private:
+    // The hash table.
+    SlotStorage<HashedObj, Allocator> array_;
+    // Current size of table.
+    size_t current_size_;
+    // Hash function.
+    HashFunc hash_function_;
+    // Total collisions counter.
+    size_t collisions_ = 0;
+    // DELETED slots since the last rehash.
+    size_t tombstones_ = 0;
+    // When the table shrinks.
+    ShrinkPolicy shrink_policy_;
+    // Consecutive Remove() calls that left the load factor below the shrink threshold.
+    size_t low_load_removes_ = 0;
+
+    // Check if position in table is ACTIVE (holds an element).
+    bool IsActive(size_t current_pos) const {
+        return array_.State(current_pos) == ACTIVE;
+    }
+
+    size_t probes_used_;   // To track number of probes used for find (most recent find).
+
+    // Return the position of x, whose hash value is hash_value.
+    // Counts the number of probes used to find x.
+    // Automatically resets the counter with each call.
+    size_t FindPos(const HashedObj& x, size_t hash_value) {
+        probes_used_ = 1;
+        size_t current_pos = hash_value % array_.size();
+
+        while (array_.State(current_pos) != EMPTY &&
+            (array_.State(current_pos) == DELETED || array_.Element(current_pos) != x)) {
+            probes_used_++;
+            collisions_++;
+            current_pos++;  // Compute ith probe.
+            if (current_pos >= array_.size())   // Wrap around table.
+                current_pos -= array_.size();
+        }
+        return current_pos;
+    }
+
+    // Return the position of x without counting probes or collisions.
+    size_t FindPos(const HashedObj& x, size_t hash_value) const {
+        size_t current_pos = hash_value % array_.size();
+
+        while (array_.State(current_pos) != EMPTY &&
+            (array_.State(current_pos) == DELETED || array_.Element(current_pos) != x)) {
+            current_pos++;  // Compute ith probe.
+            if (current_pos >= array_.size())   // Wrap around table.
+                current_pos -= array_.size();
+        }
+        return current_pos;
+    }
+
+    // Rehash hash table into new_size slots, table is getting full.
+    void Rehash(size_t new_size) {
+        // Create new empty table.
+        SlotStorage<HashedObj, Allocator> old_array(new_size, array_.GetAllocator());
+        old_array.swap(array_);
+
+        // Move elements over.
+        current_size_ = 0;
+        tombstones_ = 0;
+        for (size_t i = 0; i < old_array.size(); i++)
+            if (old_array.State(i) == ACTIVE)
+                Insert(std::move(old_array.Element(i)));
+    }
+
+    // Returns the size to rehash to once active and deleted slots fill half the
+    // table: twice the size, or the same size when tombstones are most of them,
+    // so that the rehash only clears the tombstones.
+    size_t GrowSize() {
+        if (current_size_ > array_.size() / 4)
+            return NextPrime(2 * array_.size());
+        return array_.size();
+    }
+
+    // Shrinks the table to a quarter full once Remove() has left its load factor
+    // below the shrink policy's threshold patience_ times in a row.
+    void ShrinkIfSparse() {
+        if (!shrink_policy_.enabled_)
+            return;
+        if (LoadFactor() >= shrink_policy_.min_load_) {
+            low_load_removes_ = 0;
+            return;
+        }
+        if (++low_load_removes_ < shrink_policy_.patience_)
+            return;
+
+        low_load_removes_ = 0;
+        size_t new_size = NextPrime(std::max(shrink_policy_.min_capacity_, 4 * current_size_));
+        if (new_size < array_.size())
+            Rehash(new_size);
+    }
+
+    // Internal method to test if a positive number is prime.
+    bool IsPrime(size_t n) {
+        if (n == 2 || n == 3)
+            return true;
+
+        if (n == 1 || n % 2 == 0)
+            return false;
+
+        for (size_t i = 3; i * i <= n; i += 2)
+            if (n % i == 0)
+                return false;
+
+        return true;
+    }
+
+    // Internal method to return a prime number at least as large as n.
+    size_t NextPrime(size_t n) {
+        if (n % 2 == 0)
+            ++n;
+        while (!IsPrime(n)) n += 2;
+        return n;
+    }
+};
+
+#endif  // LINEAR_PROBING_H
@@ -0,0 +1,110 @@
+// William Yang
+// lru_cache.h: A bounded least-recently-used cache with hit-rate counters.
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+
+// Class LruCache:
+// Maps keys to values, holding at most Capacity() entries.
+// When full, inserting a new key evicts the least recently used entry.
+// Counts hits and misses of Find() so the capacity can be sized.
+template <typename Key, typename Value>
+class LruCache {
+public:
+    // Constructor for cache.
+    // Capacity set to 4096 entries by default, unless specified.
+    // A capacity of 0 disables the cache (every Find() misses).
+    explicit LruCache(size_t capacity = 4096) : capacity_(capacity) { }
+
+    // Returns a pointer to the value cached for key and marks it as most recently used.
+    // Returns nullptr if key is not cached.
+    // The pointer is valid until the next call to Insert() or Clear().
+    const Value* Find(const Key& key) {
+        auto found = index_.find(key);
+        if (found == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return &found->second->second;
+    }
+
+    // Caches value for key as the most recently used entry.
+    // Replaces the value if key is already cached.
+    void Insert(const Key& key, Value value) {
+        if (capacity_ == 0)
+            return;
+
+        auto found = index_.find(key);
+        if (found != index_.end()) {
+            found->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, found->second);
+            return;
+        }
+
+        // Evict least recently used entry.
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+
+        entries_.emplace_front(key, std::move(value));
+        index_[key] = entries_.begin();
+    }
+
+    // Removes all entries and resets the hit and miss counters.
+    void Clear() {
+        entries_.clear();
+        index_.clear();
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    // Returns the number of cached entries.
+    size_t Size() const {
+        return entries_.size();
+    }
+
+    // Returns the maximum number of cached entries.
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    // Returns the number of Find() calls that found their key.
+    size_t Hits() const {
+        return hits_;
+    }
+
+    // Returns the number of Find() calls that did not find their key.
+    size_t Misses() const {
+        return misses_;
+    }
+
+    // Returns hits divided by total Find() calls (0 if Find() was never called).
+    float HitRate() const {
+        size_t lookups = hits_ + misses_;
+        return lookups == 0 ? 0.0f : (float)hits_ / lookups;
+    }
+
+private:
+    // Cached entries, most recently used first.
+    std::list<std::pair<Key, Value>> entries_;
+    // Key to position in entries_.
+    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator> index_;
+    // Maximum number of entries.
+    size_t capacity_;
+    // Find() hit counter.
+    size_t hits_ = 0;
+    // Find() miss counter.
+    size_t misses_ = 0;
+};
+
+#endif  // LRU_CACHE_H
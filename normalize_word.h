@@ -0,0 +1,82 @@
+// William Yang
+// normalize_word.h: In-place normalization of document words for the spell checker.
+
+#ifndef NORMALIZE_WORD_H
+#define NORMALIZE_WORD_H
+
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+
+// Returns true if c is an ASCII punctuation char (ispunct() in the "C" locale).
+inline bool IsAsciiPunctuation(char c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') ||
+        (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+// Lowercases the ASCII letters of the length chars at data, in place.
+// Other bytes, including non-ASCII ones, are unchanged (tolower() in the "C" locale).
+inline void LowercaseAscii(char* data, size_t length) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i before_a32 = _mm256_set1_epi8('A' - 1);
+    const __m256i after_z32 = _mm256_set1_epi8('Z' + 1);
+    const __m256i case_bit32 = _mm256_set1_epi8(0x20);
+    for (; i + 32 <= length; i += 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        // Bytes >= 0x80 are negative as signed chars and fail the first compare.
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, before_a32),
+            _mm256_cmpgt_epi8(after_z32, chars));
+        chars = _mm256_or_si256(chars, _mm256_and_si256(upper, case_bit32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), chars);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    while (i < length) {
+        // Most words are shorter than 16 chars: run them through a padded block.
+        char block[16] = { 0 };
+        size_t block_length = length - i < 16 ? length - i : 16;
+        std::memcpy(block, data + i, block_length);
+
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, before_a),
+            _mm_cmplt_epi8(chars, after_z));
+        chars = _mm_or_si128(chars, _mm_and_si128(upper, case_bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(block), chars);
+
+        std::memcpy(data + i, block, block_length);
+        i += block_length;
+    }
+#endif
+    for (; i < length; i++)
+        if (data[i] >= 'A' && data[i] <= 'Z')
+            data[i] += 'a' - 'A';
+}
+
+// Normalizes a word read from a document, in place and without allocating:
+// if the word has more than one char, removes one punctuation char from its
+// end and then one from its beginning, and lowercases its ASCII letters.
+inline void NormalizeWordInPlace(std::string& word) {
+    if (word.empty())
+        return;
+
+    LowercaseAscii(&word[0], word.size());
+    if (word.size() > 1) {   // Ensures word keeps at least one char after the first trim.
+        if (IsAsciiPunctuation(word[word.size() - 1]))
+            word.pop_back();
+        if (IsAsciiPunctuation(word[0]))
+            word.erase(0, 1);
+    }
+}
+
+#endif  // NORMALIZE_WORD_H
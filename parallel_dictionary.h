@@ -0,0 +1,191 @@
+// William Yang
+// parallel_dictionary.h: Builds a hash table from a words file on several threads.
+
+#ifndef PARALLEL_DICTIONARY_H
+#define PARALLEL_DICTIONARY_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+
+// Time spent in each phase of LoadDictionaryParallel(), in milliseconds.
+struct DictionaryLoadTimings {
+    // Reading the file into memory.
+    double read_ms_ = 0;
+    // Tokenizing, hashing and partitioning the words.
+    double tokenize_ms_ = 0;
+    // Merging the per-thread partitions and removing duplicate words.
+    double merge_ms_ = 0;
+    // Inserting the words into the table.
+    double insert_ms_ = 0;
+    // Threads used.
+    size_t threads_ = 0;
+    // Words read, including duplicates.
+    size_t words_ = 0;
+};
+
+// A word of the dictionary file with its hash value and position in the file.
+template <typename HashedObj>
+struct HashedWord {
+    // The word.
+    HashedObj word_;
+    // Hash value of the word from the table's Hash().
+    size_t hash_value_;
+    // Byte offset of the word in the file.
+    size_t order_;
+};
+
+// Returns true if c separates words, as for operator>> in the "C" locale.
+inline bool IsWordSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Returns the milliseconds elapsed since start.
+inline double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// @hash_table: an empty hash table (linear, quadratic, or double)
+// @words_filename: a filename of whitespace separated words
+// @thread_count: number of threads, 0 for one per hardware thread
+// @timings: filled with the time spent in each phase
+// Inserts every word of words_filename into hash_table, which holds HashedObj elements.
+// The file is split on newlines into one byte range per thread. Each thread
+// tokenizes its range, hashes the words with hash_table.Hash() and sorts them
+// into partitions by the top bits of their hash value. Duplicate words hash
+// alike, so each partition is deduplicated on its own thread without locking.
+// The table is then reserved to its final capacity and filled partition by
+// partition with the precomputed hash values, so it holds the same words with
+// the same Size() and Capacity() as inserting the file serially, without any
+// rehash. Only the placement of colliding words and the collision counts differ.
+// Returns false if the file cannot be read.
+template <typename HashedObj, typename HashTableType>
+bool LoadDictionaryParallel(HashTableType& hash_table, const std::string& words_filename,
+                            size_t thread_count, DictionaryLoadTimings& timings)
+{
+    typedef std::chrono::steady_clock Clock;
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    timings = DictionaryLoadTimings{};
+    timings.threads_ = thread_count;
+
+    // Read the whole file.
+    Clock::time_point phase_start = Clock::now();
+    std::ifstream words_file(words_filename, std::ios::binary);
+    if (!words_file.is_open())
+        return false;
+    const std::string text((std::istreambuf_iterator<char>(words_file)), std::istreambuf_iterator<char>());
+    words_file.close();
+    timings.read_ms_ = MillisecondsSince(phase_start);
+
+    // Split into byte ranges that end after a newline.
+    phase_start = Clock::now();
+    std::vector<size_t> range_starts{ 0 };
+    for (size_t i = 1; i < thread_count; i++) {
+        size_t start = std::max(range_starts.back(), text.size() * i / thread_count);
+        while (start > 0 && start < text.size() && text[start - 1] != '\n')
+            start++;
+        range_starts.push_back(start);
+    }
+    range_starts.push_back(text.size());
+
+    // Tokenize, hash and partition each range.
+    // partitions[t][p] holds the words of range t in partition p.
+    const size_t partition_bits = 6;
+    const size_t partition_count = size_t(1) << partition_bits;
+    std::vector<std::vector<std::vector<HashedWord<HashedObj>>>> partitions(
+        thread_count, std::vector<std::vector<HashedWord<HashedObj>>>(partition_count));
+    std::vector<size_t> range_words(thread_count, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++)
+        threads.emplace_back([&, t]() {
+            size_t position = range_starts[t];
+            const size_t end = range_starts[t + 1];
+            while (position < end) {
+                while (position < end && IsWordSeparator(text[position]))
+                    position++;
+                size_t word_start = position;
+                while (position < end && !IsWordSeparator(text[position]))
+                    position++;
+                if (word_start == position)
+                    continue;
+
+                HashedObj word(text.substr(word_start, position - word_start));
+                size_t hash_value = hash_table.Hash(word);
+                size_t partition = hash_value >> (8 * sizeof(size_t) - partition_bits);
+                // The byte offset of a word orders it within the file.
+                partitions[t][partition].push_back(HashedWord<HashedObj>{ std::move(word), hash_value, word_start });
+                range_words[t]++;
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+    for (size_t words : range_words)
+        timings.words_ += words;
+    timings.tokenize_ms_ = MillisecondsSince(phase_start);
+
+    // Merge each partition across threads and keep the first copy of every word.
+    phase_start = Clock::now();
+    std::vector<std::vector<HashedWord<HashedObj>>> merged(partition_count);
+    for (size_t t = 0; t < thread_count; t++)
+        threads.emplace_back([&, t]() {
+            for (size_t p = t; p < partition_count; p += thread_count) {
+                for (size_t r = 0; r < thread_count; r++)
+                    for (auto& entry : partitions[r][p])
+                        merged[p].push_back(std::move(entry));
+                // merged[p] is in file order. Sort (hash value, index) pairs instead of
+                // the words themselves and mark every word equal to an earlier one.
+                std::vector<std::pair<size_t, size_t>> by_hash;
+                by_hash.reserve(merged[p].size());
+                for (size_t i = 0; i < merged[p].size(); i++)
+                    by_hash.emplace_back(merged[p][i].hash_value_, i);
+                std::sort(by_hash.begin(), by_hash.end());
+
+                std::vector<bool> duplicate(merged[p].size(), false);
+                for (size_t i = 0; i < by_hash.size(); i++)
+                    for (size_t j = i; j-- > 0 && by_hash[j].first == by_hash[i].first; )
+                        if (!duplicate[by_hash[j].second] &&
+                            merged[p][by_hash[j].second].word_ == merged[p][by_hash[i].second].word_) {
+                            duplicate[by_hash[i].second] = true;
+                            break;
+                        }
+
+                // Keep the first copy of every word.
+                size_t kept = 0;
+                for (size_t i = 0; i < merged[p].size(); i++)
+                    if (!duplicate[i]) {
+                        if (kept != i)
+                            merged[p][kept] = std::move(merged[p][i]);
+                        kept++;
+                    }
+                merged[p].resize(kept);
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    size_t unique_count = 0;
+    for (const auto& partition : merged)
+        unique_count += partition.size();
+    timings.merge_ms_ = MillisecondsSince(phase_start);
+
+    // Insert with the precomputed hash values.
+    phase_start = Clock::now();
+    hash_table.Reserve(unique_count);
+    for (auto& partition : merged)
+        for (auto& entry : partition)
+            hash_table.Insert(std::move(entry.word_), entry.hash_value_);
+    timings.insert_ms_ = MillisecondsSince(phase_start);
+
+    return true;
+}
+
+#endif  // PARALLEL_DICTIONARY_H
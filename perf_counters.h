@@ -0,0 +1,184 @@
+// William Yang
+// perf_counters.h: Hardware performance counters around a benchmark phase.
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+
+// Class PerfCounters:
+// Counts hardware events of the calling thread between Start() and Stop()
+// with Linux perf_event_open(). Each event is opened on its own, so events the
+// machine or the container does not allow are reported as unavailable while the
+// others still count. On other systems every event is unavailable.
+class PerfCounters {
+public:
+    // Counted events.
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, EVENT_COUNT };
+
+    // Constructor for counters.
+    // Opens every event, disabled.
+    PerfCounters() {
+        for (int e = 0; e < EVENT_COUNT; e++) {
+            fds_[e] = -1;
+            values_[e] = 0;
+        }
+#if defined(__linux__)
+        const uint32_t types[EVENT_COUNT] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+        const uint64_t configs[EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            CacheEvent(PERF_COUNT_HW_CACHE_L1D),
+            CacheEvent(PERF_COUNT_HW_CACHE_LL),
+            PERF_COUNT_HW_BRANCH_MISSES,
+            CacheEvent(PERF_COUNT_HW_CACHE_DTLB) };
+
+        for (int e = 0; e < EVENT_COUNT; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[e] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds_[e] < 0 && error_.empty())
+                error_ = std::strerror(errno);
+        }
+#else
+        error_ = "perf_event_open() is only available on Linux";
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Closes the counters.
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int e = 0; e < EVENT_COUNT; e++)
+            if (fds_[e] >= 0)
+                close(fds_[e]);
+#endif
+    }
+
+    // Returns true if at least one event can be counted.
+    bool Available() const {
+        for (int e = 0; e < EVENT_COUNT; e++)
+            if (fds_[e] >= 0)
+                return true;
+        return false;
+    }
+
+    // Returns true if event can be counted.
+    bool Available(Event event) const {
+        return fds_[event] >= 0;
+    }
+
+    // Returns why the first unavailable event could not be opened (empty if all opened).
+    const std::string& Error() const {
+        return error_;
+    }
+
+    // Resets and starts counting.
+    void Start() {
+        start_time_ = std::chrono::steady_clock::now();
+#if defined(__linux__)
+        for (int e = 0; e < EVENT_COUNT; e++)
+            if (fds_[e] >= 0) {
+                ioctl(fds_[e], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds_[e], PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+    }
+
+    // Stops counting and reads the counts.
+    // Counts are scaled up if the kernel multiplexed the counters.
+    void Stop() {
+#if defined(__linux__)
+        for (int e = 0; e < EVENT_COUNT; e++)
+            if (fds_[e] >= 0)
+                ioctl(fds_[e], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+        elapsed_ns_ = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time_).count();
+#if defined(__linux__)
+        for (int e = 0; e < EVENT_COUNT; e++) {
+            values_[e] = 0;
+            uint64_t reading[3];   // value, time enabled, time running
+            if (fds_[e] < 0 || read(fds_[e], reading, sizeof(reading)) != (ssize_t)sizeof(reading))
+                continue;
+            values_[e] = reading[2] == 0 ? 0 : (uint64_t)((double)reading[0] * reading[1] / reading[2]);
+        }
+#endif
+    }
+
+    // Returns the count of event from the last Start()/Stop() pair.
+    uint64_t Value(Event event) const {
+        return values_[event];
+    }
+
+    // Returns the nanoseconds between the last Start() and Stop().
+    double ElapsedNanoseconds() const {
+        return elapsed_ns_;
+    }
+
+    // Returns the name of event as printed by Print().
+    static const char* Name(Event event) {
+        static const char* const names[EVENT_COUNT] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses" };
+        return names[event];
+    }
+
+    // Prints the elapsed time and one line per event: <phase>_<event>_per_op:
+    // <count / operations>, or n/a for events that cannot be counted.
+    void Print(std::ostream& out, const std::string& phase, size_t operations) const {
+        out << phase << "_ns_per_op: " << (operations == 0 ? 0.0 : elapsed_ns_ / operations) << "\n";
+        for (int e = 0; e < EVENT_COUNT; e++) {
+            out << phase << "_" << Name((Event)e) << "_per_op: ";
+            if (!Available((Event)e))
+                out << "n/a";
+            else
+                out << (operations == 0 ? 0.0 : (double)values_[e] / operations);
+            out << "\n";
+        }
+    }
+
+private:
+    // Counter file descriptors, -1 for unavailable events.
+    int fds_[EVENT_COUNT];
+    // Counts from the last Stop().
+    uint64_t values_[EVENT_COUNT];
+    // Why an event could not be opened.
+    std::string error_;
+    // Time of the last Start().
+    std::chrono::steady_clock::time_point start_time_;
+    // Nanoseconds between the last Start() and Stop().
+    double elapsed_ns_ = 0;
+
+#if defined(__linux__)
+    // Returns the config of the read miss event of a hardware cache.
+    static uint64_t CacheEvent(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+};
+
+#endif  // PERF_COUNTERS_H
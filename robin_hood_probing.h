@@ -0,0 +1,394 @@
+// William Yang
+// robin_hood_probing.h: A hash table with Robin Hood linear probing implementation.
+
+#ifndef ROBIN_HOOD_PROBING_H
+#define ROBIN_HOOD_PROBING_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "seeded_hash.h"
+#include "slot_storage.h"
+#include "table_memory.h"
+
+
+
+// Class HashTableRobinHood:
+// A hash table container with linear probing and Robin Hood insertion.
+// Each slot stores the displacement of its element, the number of slots past its
+// home slot. An insert that reaches an element closer to its home than the new
+// element takes that slot and carries the displaced element on, so displacements
+// stay even and the slots of a probe sequence are in increasing home order. A
+// lookup can therefore stop at the first slot whose displacement is smaller than
+// its own distance: the element would have been placed there. Removing shifts the
+// following elements back one slot instead of leaving a tombstone.
+template <typename HashedObj, typename HashFunc = SeededHash<HashedObj>,
+          typename Allocator = std::allocator<HashedObj>>
+class HashTableRobinHood {
+public:
+    // Used to determine if hash entries are ACTIVE or EMPTY. There is no
+    // DELETED state, since removal shifts elements back.
+    enum EntryType { ACTIVE, EMPTY };
+
+    // Default constructor for hash table.
+    // Size set to 101 by default, unless specified.
+    // If size is specified and is prime, size is set to the desired number,
+    // otherwise set the size as the next prime number after given number.
+    // Hash function seeded with DefaultHashSeed() by default, unless specified.
+    // Slot memory comes from allocator.
+    explicit HashTableRobinHood(size_t size = 101, const HashFunc& hash_function = HashFunc{},
+                                const Allocator& allocator = Allocator{})
+        : array_(NextPrime(size), allocator), displacements_(array_.size(), 0, DisplacementAllocator(allocator)),
+          hash_function_(hash_function) {
+        MakeEmpty();
+    }
+
+    // Check if the hash table contains x.
+    // Return true if x is found;
+    // false otherwise.
+    bool Contains(const HashedObj& x) {
+        size_t current_pos;
+        uint32_t distance;
+        return FindPos(x, Hash(x), current_pos, distance);
+    }
+
+    // Check if the hash table contains x without updating the probe and
+    // collision counters, so that concurrent readers can share a const table.
+    bool Contains(const HashedObj& x) const {
+        size_t current_pos;
+        uint32_t distance;
+        return FindPos(x, Hash(x), current_pos, distance);
+    }
+
+    // Clear the hash table.
+    // Under an enabled shrink policy, also gives the slots back down to its minimum capacity.
+    // Memory the allocator holds for the keys, such as a key arena, is released.
+    void MakeEmpty() {
+        current_size_ = 0;
+        low_load_removes_ = 0;
+        if (shrink_policy_.enabled_ && array_.size() > NextPrime(shrink_policy_.min_capacity_)) {
+            array_ = SlotStorage<HashedObj, Allocator>(NextPrime(shrink_policy_.min_capacity_), array_.GetAllocator());
+            displacements_.assign(array_.size(), 0);
+        } else {
+            array_.Clear();
+        }
+        array_.ReleaseElementMemory();
+        // Keep the displacements on the same allocator as the slots, which
+        // releasing may have replaced, so they never refer to a freed arena.
+        if (displacements_.get_allocator() != DisplacementAllocator(array_.GetAllocator()))
+            displacements_ = std::vector<uint32_t, DisplacementAllocator>(
+                array_.size(), 0, DisplacementAllocator(array_.GetAllocator()));
+    }
+
+    // Insert x into the hash table.
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(const HashedObj& x) {
+        size_t current_pos;
+        uint32_t distance;
+        if (FindPos(x, Hash(x), current_pos, distance))  // Failed to insert.
+            return false;
+
+        Place(current_pos, distance, HashedObj(x));
+        return true;
+    }
+
+    // Move insert x into the hash table.
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(HashedObj&& x) {
+        return Insert(std::move(x), Hash(x));
+    }
+
+    // Move insert x into the hash table, given its hash value from Hash().
+    // Lets callers hash elements ahead of time (for example on other threads).
+    // Returns true if successful;
+    // false otherwise.
+    bool Insert(HashedObj&& x, size_t hash_value) {
+        size_t current_pos;
+        uint32_t distance;
+        if (FindPos(x, hash_value, current_pos, distance))  // Failed to insert.
+            return false;
+
+        Place(current_pos, distance, std::move(x));
+        return true;
+    }
+
+    // Removes x from the hash table.
+    // The elements after x up to the next EMPTY slot or element in its home slot
+    // move back one slot, closer to their homes.
+    // Returns true if successful;
+    // false otherwise.
+    bool Remove(const HashedObj& x) {
+        size_t current_pos;
+        uint32_t distance;
+        if (!FindPos(x, Hash(x), current_pos, distance)) // Failed to remove.
+            return false;
+
+        array_.Destroy(current_pos, EMPTY);
+        size_t next_pos = NextPos(current_pos);
+        while (IsActive(next_pos) && displacements_[next_pos] > 0) {
+            array_.Construct(current_pos, std::move(array_.Element(next_pos)));
+            displacements_[current_pos] = displacements_[next_pos] - 1;
+            array_.Destroy(next_pos, EMPTY);
+            current_pos = next_pos;
+            next_pos = NextPos(next_pos);
+        }
+
+        current_size_--;
+        ShrinkIfSparse();
+        return true;
+    }
+
+    // Returns the current size of the hash table.
+    size_t Size() const {
+        return current_size_;
+    }
+
+    // Returns the capacity of the hash table.
+    size_t Capacity() const {
+        return array_.size();
+    }
+
+    // Returns the load factor of the hash table.
+    float LoadFactor() const {
+        return (float)current_size_ / array_.size();
+    }
+
+    // Returns the total collisions counter.
+    size_t TotalCollisions() const {
+        return collisions_;
+    }
+
+    // Returns the average collisions of total collisions divided by the current size.
+    float AverageCollisions() const {
+        return (float)collisions_ / current_size_;
+    }
+
+    // Return probes used for the latest FindPos() function call.
+    size_t ProbesUsed() const {
+        return probes_used_;
+    }
+
+    // Returns the largest displacement of an element from its home slot.
+    size_t MaxDisplacement() const {
+        uint32_t max_displacement = 0;
+        for (size_t i = 0; i < array_.size(); i++)
+            if (IsActive(i))
+                max_displacement = std::max(max_displacement, displacements_[i]);
+        return max_displacement;
+    }
+
+    // Returns the mean displacement of the elements from their home slots.
+    float MeanDisplacement() const {
+        size_t total = 0;
+        for (size_t i = 0; i < array_.size(); i++)
+            if (IsActive(i))
+                total += displacements_[i];
+        return current_size_ == 0 ? 0.0f : (float)total / current_size_;
+    }
+
+    // Returns the hash value of x used to place it in the table.
+    size_t Hash(const HashedObj& x) const {
+        return hash_function_(x);
+    }
+
+    // Returns the hash function of the table.
+    const HashFunc& HashFunction() const {
+        return hash_function_;
+    }
+
+    // Grows the table to the capacity it would reach after n insertions,
+    // so that inserting up to n elements does not rehash.
+    void Reserve(size_t n) {
+        size_t new_size = array_.size();
+        while (n > new_size / 2)
+            new_size = NextPrime(2 * new_size);
+        if (new_size > array_.size())
+            Rehash(new_size);
+    }
+
+    // Returns the number of tombstones: always 0, since removal shifts elements back.
+    size_t Tombstones() const {
+        return 0;
+    }
+
+    // Returns the memory footprint of the table: its slot array with the
+    // displacements, and the heap bytes owned by its keys.
+    TableMemoryUsage MemoryUsage() const {
+        TableMemoryUsage usage;
+        usage.slots_ = array_.size();
+        usage.slot_bytes_ = array_.Bytes() + displacements_.size() * sizeof(uint32_t);
+        usage.active_ = current_size_;
+        for (size_t i = 0; i < array_.size(); i++)
+            if (IsActive(i))
+                usage.key_heap_bytes_ += KeyHeapBytes(array_.Element(i));
+        return usage;
+    }
+
+    // Sets when the table shrinks after elements are removed (never, by default).
+    void SetShrinkPolicy(const ShrinkPolicy& policy) {
+        shrink_policy_ = policy;
+        low_load_removes_ = 0;
+    }
+
+    // Returns the shrink policy of the table.
+    const ShrinkPolicy& GetShrinkPolicy() const {
+        return shrink_policy_;
+    }
+
+    // Returns the allocator of the slots.
+    Allocator GetAllocator() const {
+        return Allocator(array_.GetAllocator());
+    }
+
+private:
+    // Allocator of the displacements, the slots' allocator rebound.
+    using DisplacementAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<uint32_t>;
+
+    // The hash table.
+    SlotStorage<HashedObj, Allocator> array_;
+    // Displacement of the element of each ACTIVE slot from its home slot.
+    std::vector<uint32_t, DisplacementAllocator> displacements_;
+    // Current size of table.
+    size_t current_size_;
+    // Hash function.
+    HashFunc hash_function_;
+    // Total collisions counter.
+    size_t collisions_ = 0;
+    // When the table shrinks.
+    ShrinkPolicy shrink_policy_;
+    // Consecutive Remove() calls that left the load factor below the shrink threshold.
+    size_t low_load_removes_ = 0;
+
+    // Check if position in table is ACTIVE (holds an element).
+    bool IsActive(size_t current_pos) const {
+        return array_.State(current_pos) == ACTIVE;
+    }
+
+    size_t probes_used_;   // To track number of probes used for find (most recent find).
+
+    // Returns the slot after current_pos, wrapping around the table.
+    size_t NextPos(size_t current_pos) const {
+        return current_pos + 1 < array_.size() ? current_pos + 1 : 0;
+    }
+
+    // Finds x, whose hash value is hash_value.
+    // Returns true with current_pos at x if it is found. Otherwise returns false
+    // with current_pos at the slot where x belongs, distance slots from its home.
+    // Counts the number of probes used to find x.
+    // Automatically resets the counter with each call.
+    bool FindPos(const HashedObj& x, size_t hash_value, size_t& current_pos, uint32_t& distance) {
+        probes_used_ = 1;
+        current_pos = hash_value % array_.size();
+        distance = 0;
+
+        while (IsActive(current_pos) && displacements_[current_pos] >= distance) {
+            if (array_.Element(current_pos) == x)
+                return true;
+            probes_used_++;
+            collisions_++;
+            current_pos = NextPos(current_pos);  // Compute ith probe.
+            distance++;
+        }
+        return false;
+    }
+
+    // Finds x without counting probes or collisions.
+    bool FindPos(const HashedObj& x, size_t hash_value, size_t& current_pos, uint32_t& distance) const {
+        current_pos = hash_value % array_.size();
+        distance = 0;
+
+        while (IsActive(current_pos) && displacements_[current_pos] >= distance) {
+            if (array_.Element(current_pos) == x)
+                return true;
+            current_pos = NextPos(current_pos);  // Compute ith probe.
+            distance++;
+        }
+        return false;
+    }
+
+    // Places x, which is not in the table, at current_pos, distance slots from
+    // its home, as found by FindPos(). Elements closer to their homes are
+    // displaced one at a time towards the next EMPTY slot. x is carried as an
+    // element made by the slots' allocator, so it may be swapped into a slot.
+    void Place(size_t current_pos, uint32_t distance, HashedObj&& x) {
+        HashedObj carried(array_.MakeElement(std::move(x)));
+        while (IsActive(current_pos)) {
+            if (displacements_[current_pos] < distance) {
+                using std::swap;
+                swap(carried, array_.Element(current_pos));
+                swap(distance, displacements_[current_pos]);
+            }
+            current_pos = NextPos(current_pos);
+            distance++;
+        }
+        array_.Construct(current_pos, std::move(carried));
+        displacements_[current_pos] = distance;
+
+        // Rehash.
+        if (++current_size_ > array_.size() / 2)
+            Rehash(NextPrime(2 * array_.size()));
+    }
+
+    // Rehash hash table into new_size slots, table is getting full.
+    void Rehash(size_t new_size) {
+        // Create new empty table.
+        SlotStorage<HashedObj, Allocator> old_array(new_size, array_.GetAllocator());
+        old_array.swap(array_);
+        displacements_.assign(new_size, 0);
+
+        // Move elements over.
+        current_size_ = 0;
+        for (size_t i = 0; i < old_array.size(); i++)
+            if (old_array.State(i) == ACTIVE)
+                Insert(std::move(old_array.Element(i)));
+    }
+
+    // Shrinks the table to a quarter full once Remove() has left its load factor
+    // below the shrink policy's threshold patience_ times in a row.
+    void ShrinkIfSparse() {
+        if (!shrink_policy_.enabled_)
+            return;
+        if (LoadFactor() >= shrink_policy_.min_load_) {
+            low_load_removes_ = 0;
+            return;
+        }
+        if (++low_load_removes_ < shrink_policy_.patience_)
+            return;
+
+        low_load_removes_ = 0;
+        size_t new_size = NextPrime(std::max(shrink_policy_.min_capacity_, 4 * current_size_));
+        if (new_size < array_.size())
+            Rehash(new_size);
+    }
+
+    // Internal method to test if a positive number is prime.
+    bool IsPrime(size_t n) {
+        if (n == 2 || n == 3)
+            return true;
+
+        if (n == 1 || n % 2 == 0)
+            return false;
+
+        for (size_t i = 3; i * i <= n; i += 2)
+            if (n % i == 0)
+                return false;
+
+        return true;
+    }
+
+    // Internal method to return a prime number at least as large as n.
+    size_t NextPrime(size_t n) {
+        if (n % 2 == 0)
+            ++n;
+        while (!IsPrime(n)) n += 2;
+        return n;
+    }
+};
+
+#endif  // ROBIN_HOOD_PROBING_H
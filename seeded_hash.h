@@ -0,0 +1,164 @@
+// William Yang
+// seeded_hash.h: A portable, seedable 64-bit hash function for the hash tables.
+
+#ifndef SEEDED_HASH_H
+#define SEEDED_HASH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+
+
+
+// Returns x rotated left by bits.
+inline uint64_t RotateLeft(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+// One SipRound of the SipHash state.
+inline void SipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1; v1 = RotateLeft(v1, 13); v1 ^= v0; v0 = RotateLeft(v0, 32);
+    v2 += v3; v3 = RotateLeft(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = RotateLeft(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = RotateLeft(v1, 17); v1 ^= v2; v2 = RotateLeft(v2, 32);
+}
+
+// Returns the 8 bytes at data as a little-endian 64-bit word.
+inline uint64_t LoadLittleEndian64(const char* data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// Returns the SipHash-1-3 of the length bytes at data under the 128-bit key (k0, k1).
+// SipHash is keyed: without the key, inputs that collide cannot be precomputed.
+// The result depends only on the bytes and the key, on every platform.
+inline uint64_t SipHash13(uint64_t k0, uint64_t k1, const char* data, size_t length) {
+    uint64_t v0 = 0x736F6D6570736575ULL ^ k0;
+    uint64_t v1 = 0x646F72616E646F6DULL ^ k1;
+    uint64_t v2 = 0x6C7967656E657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const size_t full_words_end = length - length % 8;
+    for (size_t i = 0; i < full_words_end; i += 8) {
+        uint64_t m = LoadLittleEndian64(data + i);
+        v3 ^= m;
+        SipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // Last word: remaining bytes, with the length in the top byte.
+    uint64_t last = (uint64_t)length << 56;
+    for (size_t i = full_words_end; i < length; i++)
+        last |= (uint64_t)(unsigned char)data[i] << (8 * (i - full_words_end));
+    v3 ^= last;
+    SipRound(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xFF;
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Returns the next value of the SplitMix64 sequence at state, used to expand seeds.
+inline uint64_t SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Seed used by default for hashing when no other seed is chosen.
+const uint64_t kDefaultHashSeed = 0;
+
+// Returns the seed storage shared by all tables of the process.
+inline std::atomic<uint64_t>& DefaultHashSeedStorage() {
+    static std::atomic<uint64_t> seed{ kDefaultHashSeed };
+    return seed;
+}
+
+// Returns the seed given to hash tables constructed without an explicit hash function.
+inline uint64_t DefaultHashSeed() {
+    return DefaultHashSeedStorage().load();
+}
+
+// Sets the seed given to hash tables constructed from now on.
+// A fixed seed makes probe and collision counts identical on every machine.
+inline void SetDefaultHashSeed(uint64_t seed) {
+    DefaultHashSeedStorage().store(seed);
+}
+
+// Returns an unpredictable seed, for tables holding words from untrusted input.
+inline uint64_t RandomHashSeed() {
+    std::random_device device;
+    uint64_t state = ((uint64_t)device() << 32) ^ device() ^
+        (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    return SplitMix64(state);
+}
+
+// Key of SipHash13() derived from a 64-bit seed.
+struct HashKey {
+    uint64_t k0_;
+    uint64_t k1_;
+
+    explicit HashKey(uint64_t seed) {
+        uint64_t state = seed;
+        k0_ = SplitMix64(state);
+        k1_ = SplitMix64(state);
+    }
+};
+
+// Returns the seeded hash value of a string: SipHash-1-3 of its chars.
+inline uint64_t SeededHashValue(const std::string& x, const HashKey& key) {
+    return SipHash13(key.k0_, key.k1_, x.data(), x.size());
+}
+
+// Returns the seeded hash value of any other hashable type: SipHash-1-3 of its std::hash value.
+// Only as portable as std::hash for that type.
+template <typename HashedObj>
+uint64_t SeededHashValue(const HashedObj& x, const HashKey& key) {
+    uint64_t value = std::hash<HashedObj>{}(x);
+    char bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    return SipHash13(key.k0_, key.k1_, bytes, sizeof(bytes));
+}
+
+// Class SeededHash:
+// Hash function object of the hash tables.
+// Equal seeds give equal hash values on every platform, so table statistics are
+// reproducible; a random seed (RandomHashSeed()) keeps untrusted input from
+// crafting keys that collide.
+template <typename HashedObj>
+class SeededHash {
+public:
+    // Constructor for hash function.
+    // Seed set to DefaultHashSeed() by default, unless specified.
+    explicit SeededHash(uint64_t seed = DefaultHashSeed()) : seed_(seed), key_(seed) { }
+
+    // Returns the hash value of x.
+    size_t operator()(const HashedObj& x) const {
+        return (size_t)SeededHashValue(x, key_);
+    }
+
+    // Returns the seed of the hash function.
+    uint64_t Seed() const {
+        return seed_;
+    }
+
+private:
+    // The seed.
+    uint64_t seed_;
+    // SipHash key derived from the seed.
+    HashKey key_;
+};
+
+#endif  // SEEDED_HASH_H
@@ -0,0 +1,197 @@
+// William Yang
+// slot_storage.h: Slot array for the open addressing hash tables.
+
+#ifndef SLOT_STORAGE_H
+#define SLOT_STORAGE_H
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+
+// Returns shared ownership of the memory the elements constructed by allocator
+// allocate from, which slots keep alive for as long as they use the allocator.
+// None unless overloaded for the allocator (see key_arena.h).
+template <typename Allocator>
+std::shared_ptr<void> AllocatorMemoryOwner(const Allocator&) {
+    return nullptr;
+}
+
+// Gives back the memory an allocator holds for the allocations of the elements
+// it constructed, once none of them is left, possibly by replacing the
+// allocator and owner, the handle from AllocatorMemoryOwner(). Nothing to give
+// back unless overloaded for the allocator (see key_arena.h).
+template <typename Allocator>
+void ReleaseAllocatorMemory(Allocator&, std::shared_ptr<void>&) {
+}
+
+// Class SlotStorage:
+// A fixed number of hash table slots, each with a state byte and room for one element.
+// Element memory is left uninitialized: an element is constructed only when its
+// slot becomes ACTIVE and destroyed when the slot is removed or cleared, so empty
+// and deleted slots cost nothing to create and hold no key memory.
+// The state bytes are a separate array, so clearing the table is a memset.
+// Both arrays come from Allocator, rebound to the element and state byte types.
+// Elements are constructed through the allocator, so an allocator such as
+// std::scoped_allocator_adaptor can hand its inner allocator to the keys; the
+// storage owns what those allocate from (AllocatorMemoryOwner()), so the keys
+// carry no ownership themselves.
+template <typename HashedObj, typename Allocator = std::allocator<HashedObj>>
+class SlotStorage {
+public:
+    // Slot states, with the same values as the tables' EntryType.
+    enum SlotState : unsigned char { ACTIVE, EMPTY, DELETED };
+
+    // Allocator of the elements and of the state bytes.
+    using ElementAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<HashedObj>;
+    using StateAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+
+    // Constructor for slot storage.
+    // All size slots start EMPTY.
+    explicit SlotStorage(size_t size = 0, const Allocator& allocator = Allocator())
+        : allocator_(allocator), memory_owner_(AllocatorMemoryOwner(allocator_)), size_(size) {
+        elements_ = ElementTraits::allocate(allocator_, size_);
+        StateAllocator state_allocator(allocator_);
+        states_ = StateTraits::allocate(state_allocator, size_);
+        if (size_ > 0)
+            std::memset(states_, EMPTY, size_);
+    }
+
+    // Copy constructor for slot storage.
+    // Copies the states and the ACTIVE elements, with the allocator the
+    // allocator selects for a copy.
+    SlotStorage(const SlotStorage& other)
+        : SlotStorage(other.size_, ElementTraits::select_on_container_copy_construction(other.allocator_)) {
+        for (size_t i = 0; i < size_; i++) {
+            if (other.states_[i] == ACTIVE)
+                ElementTraits::construct(allocator_, elements_ + i, other.elements_[i]);
+            states_[i] = other.states_[i];
+        }
+    }
+
+    // Move constructor for slot storage.
+    // Leaves other with no slots.
+    SlotStorage(SlotStorage&& other) noexcept
+        : allocator_(other.allocator_), memory_owner_(std::move(other.memory_owner_)),
+          elements_(other.elements_), states_(other.states_), size_(other.size_) {
+        other.elements_ = nullptr;
+        other.states_ = nullptr;
+        other.size_ = 0;
+    }
+
+    // Copy and move assignment for slot storage.
+    SlotStorage& operator=(SlotStorage other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    // Destroys the ACTIVE elements and frees the slots.
+    ~SlotStorage() {
+        Clear();
+        ElementTraits::deallocate(allocator_, elements_, size_);
+        StateAllocator state_allocator(allocator_);
+        StateTraits::deallocate(state_allocator, states_, size_);
+    }
+
+    // Returns the allocator of the elements.
+    const ElementAllocator& GetAllocator() const {
+        return allocator_;
+    }
+
+    // Returns the number of slots.
+    size_t size() const {
+        return size_;
+    }
+
+    // Returns the bytes of element and state memory of the slots.
+    size_t Bytes() const {
+        return size_ * (sizeof(HashedObj) + 1);
+    }
+
+    // Returns the state of the slot at pos.
+    unsigned char State(size_t pos) const {
+        return states_[pos];
+    }
+
+    // Returns the element of the ACTIVE slot at pos.
+    HashedObj& Element(size_t pos) {
+        return elements_[pos];
+    }
+
+    // Returns the element of the ACTIVE slot at pos.
+    const HashedObj& Element(size_t pos) const {
+        return elements_[pos];
+    }
+
+    // Constructs an element from args in the non-ACTIVE slot at pos and marks it ACTIVE.
+    template <typename... Args>
+    void Construct(size_t pos, Args&&... args) {
+        ElementTraits::construct(allocator_, elements_ + pos, std::forward<Args>(args)...);
+        states_[pos] = ACTIVE;
+    }
+
+    // Returns an element constructed from args the way Construct() constructs
+    // one, for elements that are moved around before they get a slot.
+    template <typename... Args>
+    HashedObj MakeElement(Args&&... args) {
+        typename std::aligned_storage<sizeof(HashedObj), alignof(HashedObj)>::type buffer;
+        HashedObj* element = reinterpret_cast<HashedObj*>(&buffer);
+        ElementTraits::construct(allocator_, element, std::forward<Args>(args)...);
+        HashedObj result(std::move(*element));
+        ElementTraits::destroy(allocator_, element);
+        return result;
+    }
+
+    // Destroys the element of the ACTIVE slot at pos and gives the slot state.
+    void Destroy(size_t pos, unsigned char state) {
+        ElementTraits::destroy(allocator_, elements_ + pos);
+        states_[pos] = state;
+    }
+
+    // Destroys all elements and marks every slot EMPTY.
+    void Clear() {
+        if (!std::is_trivially_destructible<HashedObj>::value)
+            for (size_t i = 0; i < size_; i++)
+                if (states_[i] == ACTIVE)
+                    ElementTraits::destroy(allocator_, elements_ + i);
+        if (size_ > 0)
+            std::memset(states_, EMPTY, size_);
+    }
+
+    // Gives back the memory the allocator holds for the elements' own
+    // allocations, such as key arenas, which may replace the allocator.
+    // Call only once no slot is ACTIVE.
+    void ReleaseElementMemory() {
+        ReleaseAllocatorMemory(allocator_, memory_owner_);
+    }
+
+    // Exchanges the slots of two storages.
+    void swap(SlotStorage& other) noexcept {
+        using std::swap;
+        swap(allocator_, other.allocator_);
+        memory_owner_.swap(other.memory_owner_);
+        std::swap(elements_, other.elements_);
+        std::swap(states_, other.states_);
+        std::swap(size_, other.size_);
+    }
+
+private:
+    using ElementTraits = std::allocator_traits<ElementAllocator>;
+    using StateTraits = std::allocator_traits<StateAllocator>;
+
+    // Allocator of the elements.
+    ElementAllocator allocator_;
+    // Owner of the memory the elements allocate from, if the allocator has any.
+    std::shared_ptr<void> memory_owner_;
+    // Uninitialized element memory, one element per slot.
+    HashedObj* elements_;
+    // State of each slot.
+    unsigned char* states_;
+    // Number of slots.
+    size_t size_;
+};
+
+#endif  // SLOT_STORAGE_H
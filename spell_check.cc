@@ -8,11 +8,19 @@
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <cctype>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <memory>
 
+#include "dawg_dictionary.h"
 #include "double_hashing.h"
+#include "edit_candidates.h"
+#include "flag_parsing.h"
+#include "layered_dictionary.h"
+#include "lru_cache.h"
+#include "normalize_word.h"
+#include "parallel_dictionary.h"
 #include "linear_probing.h"
 #include "quadratic_probing.h"
 
@@ -20,113 +28,68 @@ using namespace std;
 
 
 
-// Removes punctuation at the beginning and end of word.
-string removePunctuation(const string& word)
+// Append the alternative words of the incorrect word found with one kind of edit
+// to out, as well as the case letter associated with correction type.
+void printAlternatives(string& out, const EditCandidates& candidates, EditCandidate::Kind kind,
+                       const string& incorrect_word, const char& case_letter)
 {
-    string copy = word;
-    if (word.size() > 1) // Ensures copy will have at least one character when returning.
-        if (ispunct(copy[copy.size() - 1]))
-            copy.erase(copy.end() - 1);
-    if (word.size() > 1) // Ensures copy will have at least one character when returning.
-        if (ispunct(copy[0]))
-            copy.erase(copy.begin());
-    return copy;
-}
-
-// Returns the lowercase version of word.
-string toLower(const string& word)
-{
-    string copy = word;
-    transform(copy.begin(), copy.end(), copy.begin(), ptr_fun<int, int>(tolower));
-    return copy;
+    for (size_t i = 0; i < candidates.Count(); i++)
+    {
+        const EditCandidate& candidate = candidates[i];
+        if (candidate.kind_ != kind || !candidate.found_)
+            continue;
+        out.append("** ").append(incorrect_word).append(" -> ");
+        out.append(candidates.Data(candidate), candidate.length_);
+        out.append(" ** case ").push_back(case_letter);
+        out.push_back('\n');
+    }
 }
 
-// Swaps the chars of a word given the two positions.
-void swapChars(string& word, const int& pos1, const int& pos2)
+// Creates and fills double hashing hash table with all words from
+// dictionary_file.
+// With more than one thread (0 for one per hardware thread), the table is
+// built by LoadDictionaryParallel() and its phase timings are printed to cerr.
+HashTableDouble<string> MakeDictionary(const string& dictionary_file, size_t thread_count = 1)
 {
-    char temp = move(word[pos1]);
-    word[pos1] = move(word[pos2]);
-    word[pos2] = move(temp);
-}
+    HashTableDouble<string> dictionary_hash;
 
-// Adds a character to the word and tests if it is in the dictionary,
-// if it is, push to alternatives vector.
-// Try to insert a-z in all positions.
-void tryAlphabetChars(vector<string>& alts, const string& word, HashTableDouble<string>& dictionary)
-{
-    string temp = word;
-    char char_insert;
-    for (size_t i = 0; i < word.size() + 1; i++) // +1 to test inserting a-z at the end of word
+    if (thread_count != 1)
     {
-        // Insert a-z (97-122 ASCII values) into temp at position i and
-        // test if it matches a dictionary word, if so, push_back to
-        // alts vector.
-        for (int j = 97; j <= 122; j++)
+        DictionaryLoadTimings timings;
+        if (!LoadDictionaryParallel<string>(dictionary_hash, dictionary_file, thread_count, timings))
         {
-            char_insert = j;
-            temp.insert(temp.begin() + i, char_insert);
-            if (dictionary.Contains(temp))
-            {
-                alts.push_back(temp);
-            }
-            temp.erase(temp.begin() + i);
+            cerr << "Failed to read dictionary file." << endl;
+            exit(1);
         }
+        cerr << "load_threads: " << timings.threads_ << " words: " << timings.words_
+             << " read_ms: " << timings.read_ms_ << " tokenize_ms: " << timings.tokenize_ms_
+             << " merge_ms: " << timings.merge_ms_ << " insert_ms: " << timings.insert_ms_ << endl;
+        return dictionary_hash;
     }
-}
 
-// Removes a character from the word and tests if it is in the dictionary,
-// if it is, push to alternatives vector.
-// Try removing a char in all positions (removes only one char from word).
-void tryRemoveAChar(vector<string>& alts, const string& word, HashTableDouble<string>& dictionary)
-{
-    string temp = word;
-    char char_removed;
-    for (size_t i = 0; i < word.size(); i++)
+    // Read dictionary file.
+    fstream dictionary_file_stream(dictionary_file);
+    if (!dictionary_file_stream.is_open())
     {
-        char_removed = temp[i]; // Needed to put removed character back into temp.
-        temp.erase(temp.begin() + i);
-        if (dictionary.Contains(temp))
-        {
-            if (alts.empty())
-                alts.push_back(temp);
-            else if (alts.back() != temp)
-                alts.push_back(temp);
-        }
-        temp.insert(temp.begin() + i, char_removed);
+        cerr << "Failed to read dictionary file." << endl;
+        exit(1);
     }
-}
 
-// Swaps adjacent characters in given word and tests if it is in the dictionary,
-// if it is, push to alternatives vector.
-void trySwappingChars(vector<string>& alts, const string& word, HashTableDouble<string>& dictionary)
-{
-    string temp = word;
-    for (size_t i = 0; i < word.size() -1; i++)
+    string word;
+    // Fill dictionary_hash.
+    while (dictionary_file_stream >> word && !dictionary_file_stream.fail())
     {
-        swapChars(temp, i, i + 1);
-        if (dictionary.Contains(temp))
-        {
-            alts.push_back(temp);
-        }
-        swapChars(temp, i, i + 1);
+        dictionary_hash.Insert(move(word));
     }
-}
 
-// Print the alternative words of the incorrect word
-// as well as the case letter associated with correction type.
-void printAlternatives(const vector<string>& alts, const string& incorrect_word, const char& case_letter)
-{
-    for (size_t i = 0; i < alts.size(); i++)
-        cout << "** " << incorrect_word << " -> " << alts[i] << " ** case " << case_letter << endl;
+    dictionary_file_stream.close();
+
+    return dictionary_hash;
 }
 
-// Creates and fills double hashing hash table with all words from
-// dictionary_file
-HashTableDouble<string> MakeDictionary(const string& dictionary_file)
+// Builds a DAWG dictionary from all words of dictionary_file.
+DawgDictionary MakeDawgDictionary(const string& dictionary_file)
 {
-    HashTableDouble<string> dictionary_hash;
-
-    // Read dictionary file.
     fstream dictionary_file_stream(dictionary_file);
     if (!dictionary_file_stream.is_open())
     {
@@ -134,21 +97,126 @@ HashTableDouble<string> MakeDictionary(const string& dictionary_file)
         exit(1);
     }
 
+    vector<string> words;
     string word;
-    // Fill dictionary_hash.
     while (dictionary_file_stream >> word && !dictionary_file_stream.fail())
+        words.push_back(move(word));
+    dictionary_file_stream.close();
+
+    DawgDictionary dictionary;
+    if (!dictionary.Build(words))
     {
-        dictionary_hash.Insert(move(word));
+        cerr << "Dictionary too large for a DAWG." << endl;
+        exit(1);
     }
+    return dictionary;
+}
 
-    dictionary_file_stream.close();
+// Result of spell checking one normalized word.
+struct WordVerdict {
+    // True if the word is in the dictionary.
+    bool correct_;
+    // The CORRECT/INCORRECT line followed by any alternative words, as printed.
+    string output_;
+};
 
-    return dictionary_hash;
+// Options for SpellChecker(), set from optional command line flags.
+struct SpellCheckOptions {
+    // Maximum number of distinct words whose verdicts are cached (0 disables the cache).
+    size_t cache_capacity_ = 4096;
+    // Read the whole document first and check each distinct word only once.
+    bool two_pass_ = false;
+    // Print cache counters to cerr after checking the document.
+    bool print_cache_stats_ = false;
+    // Word lists layered on top of the dictionary.
+    vector<string> overlay_files_;
+    // Threads used to build the dictionary (0 for one per hardware thread).
+    size_t load_threads_ = 1;
+    // Store the dictionary as a DAWG instead of a hash table.
+    bool dawg_ = false;
+    // Print the memory and lookup speed of both dictionary backends to cerr.
+    bool compare_backends_ = false;
+    // Also offer alternatives with one char substituted (case D).
+    bool substitutions_ = false;
+};
+
+// Checks the 3 cases (4 with substitutions) for a normalized word being
+// misspelled and renders the output for it into out, replacing its contents.
+// Returns true if the word is in the dictionary.
+// The alternatives are generated and checked in the reused buffers of
+// candidates, and out keeps its capacity, so a buffer reused across words
+// makes checking allocation free once the buffers fit.
+template <typename DictionaryType>
+bool CheckWord(DictionaryType& dictionary, const string& word, EditCandidates& candidates, string& out)
+{
+    out.assign(word);
+
+    // If word is in dictionary, print:
+    // <word> is CORRECT
+    if (dictionary.Contains(word))
+    {
+        out.append(" is CORRECT\n");
+        return true;
+    }
+
+    // Word does not exist in dictionary, print:
+    // <word> is INCORRECT
+    out.append(" is INCORRECT\n");
+
+    // Find alternatives for the incorrect word from the dictionary
+    // and print them.
+    candidates.Generate(word);
+    candidates.Check(dictionary);
+    printAlternatives(out, candidates, EditCandidate::INSERTION, word, 'A');
+    printAlternatives(out, candidates, EditCandidate::DELETION, word, 'B');
+    printAlternatives(out, candidates, EditCandidate::TRANSPOSITION, word, 'C');
+    printAlternatives(out, candidates, EditCandidate::SUBSTITUTION, word, 'D');
+
+    return false;
+}
+
+// Checks a word against one pinned snapshot of the layered dictionary, so that
+// an overlay reload while the word is being checked cannot mix two versions.
+template <typename HashedObj, typename BaseTable, typename OverlayTable>
+bool CheckWord(LayeredDictionary<HashedObj, BaseTable, OverlayTable>& dictionary, const string& word,
+               EditCandidates& candidates, string& out)
+{
+    auto snapshot = dictionary.Read();
+    return CheckWord(*snapshot, word, candidates, out);
+}
+
+// Returns the version of the dictionary contents.
+// A hash table never changes while it is being used as a dictionary.
+template <typename DictionaryType>
+size_t DictionaryVersion(const DictionaryType&)
+{
+    return 0;
+}
+
+// Returns the version of the layered dictionary's current snapshot.
+template <typename HashedObj, typename BaseTable, typename OverlayTable>
+size_t DictionaryVersion(const LayeredDictionary<HashedObj, BaseTable, OverlayTable>& dictionary)
+{
+    return dictionary.Version();
+}
+
+// Loads overlay_file into its own hash table and publishes it as an overlay of
+// dictionary, replacing the overlay previously loaded from the same file.
+// Safe to call while other threads are checking words with dictionary.
+template <typename BaseTable>
+void LoadOverlay(LayeredDictionary<string, BaseTable, HashTableDouble<string>>& dictionary, const string& overlay_file)
+{
+    dictionary.SetOverlay(overlay_file, make_shared<const HashTableDouble<string>>(MakeDictionary(overlay_file)));
 }
 
 // For each word in the document_file, it checks the 3 cases for a word being
-// misspelled and prints out possible corrections
-void SpellChecker(HashTableDouble<string>& dictionary, const string &document_file)
+// misspelled and prints out possible corrections.
+// Verdicts of repeated words are served from a bounded LRU cache, or, in two
+// pass mode, computed once per distinct word.
+// The cache is dropped whenever the dictionary version changes.
+template <typename DictionaryType>
+void SpellChecker(DictionaryType& dictionary, const string &document_file,
+                  const SpellCheckOptions& options = SpellCheckOptions{})
 {
     // Read document file.
     fstream document_file_stream(document_file);
@@ -158,44 +226,187 @@ void SpellChecker(HashTableDouble<string>& dictionary, const string &document_fi
         exit(1);
     }
 
+    // Reused across words: the candidate buffers and the rendered output.
+    EditCandidates candidates(options.substitutions_);
+    string output;
     string input_word;
-    vector<string> alternative_words;
-    // Check for corrections of input word from document file.
-    while (document_file_stream >> input_word && !document_file_stream.fail())
+    if (options.two_pass_)
     {
-        // Remove punctuations at the beginning and end of input word
-        // and set word to lower case for comparisons.
-        input_word = toLower(removePunctuation(input_word));
-
-        // If word is in dictionary, print:
-        // <word> is CORRECT
-        if (dictionary.Contains(input_word))
+        // First pass: collect the normalized words and their distinct set.
+        vector<string> document_words;
+        unordered_map<string, WordVerdict> verdicts;
+        while (document_file_stream >> input_word && !document_file_stream.fail())
         {
-            cout << input_word << " is CORRECT" << endl;
-            continue;
+            NormalizeWordInPlace(input_word);
+            document_words.push_back(input_word);
+            verdicts.emplace(document_words.back(), WordVerdict{ false, string() });
         }
 
-        // Word does not exist in dictionary, print:
-        // <word> is INCORRECT
-        cout << input_word << " is INCORRECT" << endl;
-
-        // Find alternatives for the incorrect word from the dictionary
-        // and print them.
-        tryAlphabetChars(alternative_words, input_word, dictionary);
-        printAlternatives(alternative_words, input_word, 'A');
-        alternative_words.clear();
-        tryRemoveAChar(alternative_words, input_word, dictionary);
-        printAlternatives(alternative_words, input_word, 'B');
-        alternative_words.clear();
-        trySwappingChars(alternative_words, input_word, dictionary);
-        printAlternatives(alternative_words, input_word, 'C');
-        alternative_words.clear();
+        // Second pass: check each distinct word once, then print in document order.
+        for (auto& entry : verdicts)
+            entry.second.correct_ = CheckWord(dictionary, entry.first, candidates, entry.second.output_);
+        for (const auto& word : document_words)
+            cout << verdicts[word].output_;
 
+        if (options.print_cache_stats_)
+            cerr << "words: " << document_words.size()
+                 << " distinct_words: " << verdicts.size() << endl;
+    }
+    else
+    {
+        LruCache<string, WordVerdict> cache(options.cache_capacity_);
+        size_t cached_version = DictionaryVersion(dictionary);
+        // Check for corrections of input word from document file.
+        while (document_file_stream >> input_word && !document_file_stream.fail())
+        {
+            // Remove punctuations at the beginning and end of input word
+            // and set word to lower case for comparisons.
+            NormalizeWordInPlace(input_word);
+
+            size_t version = DictionaryVersion(dictionary);
+            if (version != cached_version)
+            {
+                cache.Clear();
+                cached_version = version;
+            }
+
+            const WordVerdict* cached = cache.Find(input_word);
+            if (cached != nullptr)
+            {
+                cout << cached->output_;
+                continue;
+            }
+
+            const bool correct = CheckWord(dictionary, input_word, candidates, output);
+            cout << output;
+            // Only a verdict that is kept is copied out of the reused buffer.
+            if (cache.Capacity() > 0)
+                cache.Insert(input_word, WordVerdict{ correct, output });
+        }
+
+        if (options.print_cache_stats_)
+            cerr << "cache_hits: " << cache.Hits()
+                 << " cache_misses: " << cache.Misses()
+                 << " cache_hit_rate: " << cache.HitRate()
+                 << " cache_size: " << cache.Size() << "/" << cache.Capacity() << endl;
     }
 
     document_file_stream.close();
 }
 
+// Returns the nanoseconds per word taken by check(word) over words.
+template <typename CheckFunction>
+double NanosecondsPerWord(const vector<string>& words, CheckFunction check)
+{
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (const auto& word : words)
+        check(word);
+    return words.empty() ? 0.0 : MillisecondsSince(start) * 1e6 / words.size();
+}
+
+// Builds both dictionary backends from dictionary_file and prints to cerr the
+// bytes each uses, next to the bytes of the words themselves, and the time per
+// word to look up and to fully check (including A/B/C alternatives) the words
+// of document_file.
+void CompareDictionaryBackends(const string& dictionary_file, const string& document_file)
+{
+    fstream document_file_stream(document_file);
+    vector<string> document_words;
+    string input_word;
+    while (document_file_stream >> input_word && !document_file_stream.fail())
+    {
+        NormalizeWordInPlace(input_word);
+        document_words.push_back(input_word);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    HashTableDouble<string> hash_dictionary = MakeDictionary(dictionary_file);
+    const double hash_build_ms = MillisecondsSince(start);
+    start = chrono::steady_clock::now();
+    DawgDictionary dawg_dictionary = MakeDawgDictionary(dictionary_file);
+    const double dawg_build_ms = MillisecondsSince(start);
+
+    const TableMemoryUsage hash_memory = hash_dictionary.MemoryUsage();
+    size_t word_bytes = 0;
+    fstream dictionary_file_stream(dictionary_file);
+    while (dictionary_file_stream >> input_word && !dictionary_file_stream.fail())
+        word_bytes += input_word.size() + 1;
+
+    // The results are summed so that the lookups cannot be optimized away.
+    size_t found = 0;
+    const double hash_lookup_ns = NanosecondsPerWord(document_words, [&](const string& word) { found += hash_dictionary.Contains(word); });
+    const double dawg_lookup_ns = NanosecondsPerWord(document_words, [&](const string& word) { found += dawg_dictionary.Contains(word); });
+    EditCandidates candidates;
+    string output;
+    size_t output_bytes = 0;
+    const double hash_check_ns = NanosecondsPerWord(document_words, [&](const string& word) { CheckWord(hash_dictionary, word, candidates, output); output_bytes += output.size(); });
+    const double dawg_check_ns = NanosecondsPerWord(document_words, [&](const string& word) { CheckWord(dawg_dictionary, word, candidates, output); output_bytes += output.size(); });
+
+    cerr << "dictionary_words: " << dawg_dictionary.Size() << " word_bytes: " << word_bytes
+         << " document_words: " << document_words.size() << " found: " << found / 2
+         << " output_bytes: " << output_bytes / 2 << endl;
+    cerr << "hash_bytes: " << sizeof(hash_dictionary) + hash_memory.TotalBytes()
+         << " hash_build_ms: " << hash_build_ms
+         << " hash_lookup_ns_per_word: " << hash_lookup_ns
+         << " hash_check_ns_per_word: " << hash_check_ns << endl;
+    cerr << "dawg_bytes: " << dawg_dictionary.Bytes() << " dawg_edges: " << dawg_dictionary.EdgeCount()
+         << " dawg_build_ms: " << dawg_build_ms
+         << " dawg_lookup_ns_per_word: " << dawg_lookup_ns
+         << " dawg_check_ns_per_word: " << dawg_check_ns << endl;
+}
+
+// Parses the optional flags following the document and dictionary filenames:
+// --cache=<entries>  verdict cache capacity (0 disables it)
+// --two-pass         check each distinct word of the document once
+// --cache-stats      print cache counters to cerr
+// --overlay=<file>   add a word list on top of the dictionary (repeatable)
+// --threads=<count>  build the dictionary on count threads (0 for all hardware threads)
+// --seed=<n>         fixed hash seed instead of a random one
+// --substitutions    also offer alternatives with one char substituted (case D)
+// --dawg             store the dictionary as a DAWG instead of a hash table
+// --compare-backends print the memory and lookup speed of the hash table and DAWG dictionaries to cerr
+SpellCheckOptions ParseSpellCheckOptions(int argument_count, char** argument_list)
+{
+    SpellCheckOptions options;
+    for (int i = 3; i < argument_count; i++)
+    {
+        const string flag(argument_list[i]);
+        if (flag.compare(0, 8, "--cache=") == 0)
+            options.cache_capacity_ = ParseUnsignedFlag(flag, flag.substr(8));
+        else if (flag == "--two-pass")
+            options.two_pass_ = true;
+        else if (flag == "--cache-stats")
+            options.print_cache_stats_ = true;
+        else if (flag.compare(0, 10, "--overlay=") == 0)
+            options.overlay_files_.push_back(flag.substr(10));
+        else if (flag.compare(0, 10, "--threads=") == 0)
+            options.load_threads_ = ParseUnsignedFlag(flag, flag.substr(10));
+        else if (flag == "--substitutions")
+            options.substitutions_ = true;
+        else if (flag == "--dawg")
+            options.dawg_ = true;
+        else if (flag == "--compare-backends")
+            options.compare_backends_ = true;
+        else if (flag.compare(0, 7, "--seed=") == 0)
+            SetDefaultHashSeed(ParseUnsignedFlag(flag, flag.substr(7)));
+        else
+            cerr << "Ignoring unknown option " << flag << endl;
+    }
+    return options;
+}
+
+// Spell checks document_file against base with the overlay files of options
+// layered on top of it.
+template <typename BaseTable>
+void SpellCheckerWithOverlays(shared_ptr<const BaseTable> base, const string& document_file,
+                              const SpellCheckOptions& options)
+{
+    LayeredDictionary<string, BaseTable, HashTableDouble<string>> dictionary(move(base));
+    for (const auto& overlay_file : options.overlay_files_)
+        LoadOverlay(dictionary, overlay_file);
+    SpellChecker(dictionary, document_file, options);
+}
+
 // @argument_count: same as argc in main
 // @argument_list: save as argv in main.
 // Implements
@@ -204,10 +415,34 @@ int testSpellingWrapper(int argument_count, char** argument_list)
     const string document_filename(argument_list[1]);
     const string dictionary_filename(argument_list[2]);
     
+    // Documents come from outside: seed the dictionary hash unpredictably
+    // unless a seed is given, so words cannot be crafted to collide.
+    SetDefaultHashSeed(RandomHashSeed());
+
     // Call functions implementing the assignment requirements.
-    HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
-    SpellChecker(dictionary, document_filename);
+    const SpellCheckOptions options = ParseSpellCheckOptions(argument_count, argument_list);
+    if (options.compare_backends_)
+        CompareDictionaryBackends(dictionary_filename, document_filename);
+
+    if (options.dawg_)
+    {
+        DawgDictionary dictionary = MakeDawgDictionary(dictionary_filename);
+        if (options.overlay_files_.empty())
+            SpellChecker(dictionary, document_filename, options);
+        else
+            SpellCheckerWithOverlays(make_shared<const DawgDictionary>(move(dictionary)), document_filename, options);
+        return 0;
+    }
+
+    if (options.overlay_files_.empty())
+    {
+        HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename, options.load_threads_);
+        SpellChecker(dictionary, document_filename, options);
+        return 0;
+    }
 
+    SpellCheckerWithOverlays(make_shared<const HashTableDouble<string>>(MakeDictionary(dictionary_filename, options.load_threads_)),
+                             document_filename, options);
     return 0;
 }
 
@@ -218,8 +453,8 @@ int testSpellingWrapper(int argument_count, char** argument_list)
 /*
 int main(int argc, char** argv)
 {
-    if (argc != 3) {
-        cout << "Usage: " << argv[0] << " <document-file> <dictionary-file>" << endl;
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " <document-file> <dictionary-file> [--cache=N] [--two-pass] [--cache-stats] [--overlay=FILE]... [--threads=N] [--seed=N] [--substitutions] [--dawg] [--compare-backends]" << endl;
         return 0;
     }
     
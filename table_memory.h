@@ -0,0 +1,93 @@
+// William Yang
+// table_memory.h: Memory accounting and the shrink policy of the hash tables.
+
+#ifndef TABLE_MEMORY_H
+#define TABLE_MEMORY_H
+
+#include <cstddef>
+#include <string>
+
+
+
+// Memory footprint of a hash table, from MemoryUsage().
+struct TableMemoryUsage {
+    // Slots of the table.
+    size_t slots_ = 0;
+    // Bytes of the slot array: element memory and state bytes.
+    size_t slot_bytes_ = 0;
+    // Bytes the ACTIVE keys own outside the slot array.
+    size_t key_heap_bytes_ = 0;
+    // ACTIVE slots.
+    size_t active_ = 0;
+    // DELETED slots, which still lengthen probe sequences until the next rehash.
+    size_t tombstones_ = 0;
+
+    // Returns the slot bytes plus the key heap bytes.
+    size_t TotalBytes() const {
+        return slot_bytes_ + key_heap_bytes_;
+    }
+
+    // Adds the usage of another table, e.g. of another shard.
+    TableMemoryUsage& operator+=(const TableMemoryUsage& other) {
+        slots_ += other.slots_;
+        slot_bytes_ += other.slot_bytes_;
+        key_heap_bytes_ += other.key_heap_bytes_;
+        active_ += other.active_;
+        tombstones_ += other.tombstones_;
+        return *this;
+    }
+};
+
+// Returns the heap bytes owned by a string: none if its chars fit in the
+// string itself (small string optimization), otherwise its capacity and terminator.
+inline size_t KeyHeapBytes(const std::string& x) {
+    const char* object = reinterpret_cast<const char*>(&x);
+    if (x.data() >= object && x.data() < object + sizeof(x))
+        return 0;
+    return x.capacity() + 1;
+}
+
+// Returns the heap bytes owned by any other key type: none unless overloaded.
+template <typename HashedObj>
+size_t KeyHeapBytes(const HashedObj&) {
+    return 0;
+}
+
+// LookupKey() for key types with a Borrow(), preferred by its int argument.
+template <typename HashedObj>
+auto MakeLookupKey(const std::string& x, int) -> decltype(HashedObj::Borrow(x)) {
+    return HashedObj::Borrow(x);
+}
+
+// LookupKey() for other key types: a copy of x.
+template <typename HashedObj>
+HashedObj MakeLookupKey(const std::string& x, long) {
+    return HashedObj(x);
+}
+
+// Returns a key of type HashedObj equal to x for lookups. Key types with a
+// Borrow() (such as InlineKey) borrow the chars of x instead of copying them,
+// so x must outlive the key. Hash tables copy the keys they insert by const
+// reference, and those copies own their chars.
+template <typename HashedObj>
+HashedObj LookupKey(const std::string& x) {
+    return MakeLookupKey<HashedObj>(x, 0);
+}
+
+// When a hash table gives memory back after elements are removed.
+// Tables grow when half full and, when enabled, shrink to a quarter full
+// after their load factor stays below min_load_ for patience_ consecutive
+// Remove() calls. The gap between the thresholds keeps a table whose size
+// hovers around one of them from rehashing back and forth.
+struct ShrinkPolicy {
+    // Shrink at all; off by default, so tables only grow.
+    bool enabled_ = false;
+    // Load factor below which Remove() counts towards a shrink.
+    float min_load_ = 0.125f;
+    // Consecutive Remove() calls below min_load_ before the table shrinks.
+    size_t patience_ = 64;
+    // Capacity the table never shrinks below.
+    size_t min_capacity_ = 101;
+};
+
+#endif  // TABLE_MEMORY_H
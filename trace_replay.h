@@ -0,0 +1,321 @@
+// William Yang
+// trace_replay.h: Replays traces of mixed insert/contains/remove operations
+// against the hash tables and measures throughput, latency and memory.
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__)
+#include <sys/resource.h>
+#endif
+
+#include "seeded_hash.h"
+#include "table_memory.h"
+
+
+
+// An operation of a trace.
+struct TraceOp {
+    // Kind of operation.
+    enum Type : uint8_t { INSERT, CONTAINS, REMOVE };
+
+    // The operation.
+    Type type_;
+    // Index of the key in Trace::keys_.
+    uint32_t key_;
+};
+
+// A sequence of operations on string keys.
+struct Trace {
+    // Distinct keys of the trace.
+    std::vector<std::string> keys_;
+    // The operations, in order.
+    std::vector<TraceOp> ops_;
+
+    // Appends an operation on key.
+    void Add(TraceOp::Type type, const std::string& key) {
+        auto found = key_index_.find(key);
+        if (found == key_index_.end()) {
+            found = key_index_.emplace(key, (uint32_t)keys_.size()).first;
+            keys_.push_back(key);
+        }
+        ops_.push_back(TraceOp{ type, found->second });
+    }
+
+private:
+    // Key to index in keys_.
+    std::unordered_map<std::string, uint32_t> key_index_;
+};
+
+// First bytes of a binary trace file.
+const char kBinaryTraceMagic[] = "HTRACE1\n";
+
+// Reads a trace file into trace.
+// Binary traces start with kBinaryTraceMagic, followed by one record per
+// operation: the type (1 byte: 0 insert, 1 contains, 2 remove), the key length
+// (2 bytes, little-endian) and the key bytes.
+// Text traces have one operation per line: "insert <key>", "contains <key>" or
+// "remove <key>" (or "i", "c", "r"). Blank lines are skipped.
+// Returns false if the file cannot be read, a binary record is malformed or
+// a non-blank text line is not exactly an operation and a key; then, for a
+// text line, its number (from 1) is stored in bad_line if it is not null.
+inline bool ReadTrace(const std::string& filename, Trace& trace, size_t* bad_line = nullptr) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[sizeof(kBinaryTraceMagic) - 1];
+    file.read(magic, sizeof(magic));
+    if (file.gcount() == (std::streamsize)sizeof(magic) &&
+        std::memcmp(magic, kBinaryTraceMagic, sizeof(magic)) == 0) {
+        unsigned char header[3];
+        std::string key;
+        while (file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            if (header[0] > TraceOp::REMOVE)
+                return false;
+            key.resize(header[1] | (header[2] << 8));
+            if (!key.empty() && !file.read(&key[0], key.size()))
+                return false;
+            trace.Add((TraceOp::Type)header[0], key);
+        }
+        return file.gcount() == 0;
+    }
+
+    file.clear();
+    file.seekg(0);
+    std::string line, operation, key, extra;
+    for (size_t line_number = 1; std::getline(file, line); line_number++) {
+        std::istringstream fields(line);
+        if (!(fields >> operation))
+            continue;
+        bool valid = (fields >> key) && !(fields >> extra);
+        TraceOp::Type type = TraceOp::CONTAINS;
+        if (operation == "insert" || operation == "i")
+            type = TraceOp::INSERT;
+        else if (operation == "remove" || operation == "r")
+            type = TraceOp::REMOVE;
+        else if (operation != "contains" && operation != "c")
+            valid = false;
+        if (!valid) {
+            if (bad_line != nullptr)
+                *bad_line = line_number;
+            return false;
+        }
+        trace.Add(type, key);
+    }
+    return true;
+}
+
+// Writes trace to filename in the binary format read by ReadTrace().
+// Keys longer than 65535 bytes are truncated.
+// Returns false if the file cannot be written.
+inline bool WriteBinaryTrace(const std::string& filename, const Trace& trace) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    file.write(kBinaryTraceMagic, sizeof(kBinaryTraceMagic) - 1);
+    for (const auto& op : trace.ops_) {
+        const std::string& key = trace.keys_[op.key_];
+        size_t length = std::min(key.size(), (size_t)0xFFFF);
+        const unsigned char header[3] = {
+            (unsigned char)op.type_, (unsigned char)(length & 0xFF), (unsigned char)(length >> 8) };
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(key.data(), length);
+    }
+    return (bool)file;
+}
+
+// @keys: keys to draw from, most popular first
+// @op_count: number of operations
+// @read_ratio: fraction of contains operations, to a thousandth; the rest are
+// half inserts, half removes
+// @zipf_skew: Zipf exponent of key popularity (0 for uniform)
+// @seed: seed of the random generator
+// Returns a synthetic trace in which the key of rank k is drawn with
+// probability proportional to 1 / k^zipf_skew.
+// Draws are taken straight from mt19937_64, whose output the standard fixes,
+// so a seed gives the same trace with every standard library.
+inline Trace GenerateTrace(const std::vector<std::string>& keys, size_t op_count,
+                           double read_ratio, double zipf_skew, uint64_t seed) {
+    Trace trace;
+    if (keys.empty())
+        return trace;
+
+    // Cumulative Zipf weights of the key ranks.
+    std::vector<double> cumulative(keys.size());
+    double total = 0;
+    for (size_t k = 0; k < keys.size(); k++) {
+        total += 1.0 / std::pow((double)(k + 1), zipf_skew);
+        cumulative[k] = total;
+    }
+
+    // Operation kinds are drawn per thousand: contains below read_limit,
+    // insert below insert_limit, remove above.
+    const uint64_t read_limit = (uint64_t)std::llround(std::min(std::max(read_ratio, 0.0), 1.0) * 1000);
+    const uint64_t insert_limit = read_limit + (1000 - read_limit) / 2;
+
+    std::mt19937_64 generator(seed);
+    for (size_t i = 0; i < op_count; i++) {
+        // Top 53 bits of a draw as a double in [0, 1).
+        const double uniform = (double)(generator() >> 11) * (1.0 / 9007199254740992.0);
+        size_t k = std::lower_bound(cumulative.begin(), cumulative.end(), uniform * total) - cumulative.begin();
+        k = std::min(k, keys.size() - 1);
+
+        const uint64_t kind = generator() % 1000;
+        TraceOp::Type type = TraceOp::CONTAINS;
+        if (kind >= read_limit)
+            type = kind < insert_limit ? TraceOp::INSERT : TraceOp::REMOVE;
+        trace.Add(type, keys[k]);
+    }
+    return trace;
+}
+
+// Measurements of ReplayTrace().
+struct ReplayReport {
+    // Operations replayed.
+    size_t ops_ = 0;
+    // Threads used.
+    size_t threads_ = 0;
+    // Wall time of the replay, in seconds.
+    double seconds_ = 0;
+    // Operations per second.
+    double ops_per_second_ = 0;
+    // Latency percentiles of single operations, in nanoseconds.
+    double p50_ns_ = 0;
+    double p90_ns_ = 0;
+    double p99_ns_ = 0;
+    double p999_ns_ = 0;
+    double max_ns_ = 0;
+    // Elements in the tables after the replay.
+    size_t final_size_ = 0;
+    // Memory of the tables after the replay.
+    TableMemoryUsage memory_;
+    // Peak resident memory of the process, in kilobytes (0 if unknown).
+    long max_rss_kb_ = 0;
+};
+
+// Returns the peak resident memory of the process in kilobytes (0 if unknown).
+inline long MaxResidentKilobytes() {
+#if defined(__unix__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+// Returns the shard of key among shard_count shards, by SipHash-1-3 keyed by
+// seed, so shards are the same with every standard library. The hash key is
+// the complement of seed's, so that shards and the slots of tables seeded
+// with seed are independent.
+inline size_t TraceShard(const std::string& key, size_t shard_count, uint64_t seed) {
+    return (size_t)(SeededHashValue(key, HashKey(~seed)) % shard_count);
+}
+
+// Inserts every key, as a KeyType, into its shard of shards, e.g. to preload a
+// dictionary before ReplayTrace(). seed is the seed given to ReplayTrace().
+template <typename KeyType = std::string, typename HashTableType>
+void InsertIntoShards(std::vector<HashTableType>& shards, const std::vector<std::string>& keys, uint64_t seed) {
+    for (const auto& key : keys)
+        shards[TraceShard(key, shards.size(), seed)].Insert(KeyType(key));
+}
+
+// @shards: the tables, one per shard, already holding any preloaded keys
+// @trace: the operations to replay
+// @thread_count: number of threads replaying the trace
+// @seed: seed of the shard hash
+// Replays trace against the shards. Keys are spread over the shards by
+// TraceShard() and each shard is guarded by its own mutex, since the tables are
+// not thread safe. Thread t replays operations t, t + thread_count, ... in
+// order. Every operation is timed on its own for the latency percentiles.
+// The keys are converted to KeyType, the key type of the tables, beforehand,
+// with LookupKey(): they may refer to the keys of trace.
+template <typename KeyType = std::string, typename HashTableType>
+ReplayReport ReplayTrace(std::vector<HashTableType>& shards, const Trace& trace, size_t thread_count,
+                         uint64_t seed) {
+    typedef std::chrono::steady_clock Clock;
+    if (thread_count == 0)
+        thread_count = 1;
+
+    std::vector<KeyType> keys;
+    keys.reserve(trace.keys_.size());
+    for (const auto& key : trace.keys_)
+        keys.push_back(LookupKey<KeyType>(key));
+    std::vector<size_t> key_shards(trace.keys_.size());
+    for (size_t k = 0; k < trace.keys_.size(); k++)
+        key_shards[k] = TraceShard(trace.keys_[k], shards.size(), seed);
+
+    std::vector<std::mutex> shard_mutexes(shards.size());
+    std::vector<std::vector<uint32_t>> latencies(thread_count);
+    std::vector<std::thread> threads;
+    const Clock::time_point replay_start = Clock::now();
+    for (size_t t = 0; t < thread_count; t++)
+        threads.emplace_back([&, t]() {
+            latencies[t].reserve(trace.ops_.size() / thread_count + 1);
+            for (size_t i = t; i < trace.ops_.size(); i += thread_count) {
+                const TraceOp& op = trace.ops_[i];
+                const KeyType& key = keys[op.key_];
+                const size_t shard = key_shards[op.key_];
+
+                const Clock::time_point op_start = Clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(shard_mutexes[shard]);
+                    if (op.type_ == TraceOp::INSERT)
+                        shards[shard].Insert(key);
+                    else if (op.type_ == TraceOp::CONTAINS)
+                        shards[shard].Contains(key);
+                    else
+                        shards[shard].Remove(key);
+                }
+                latencies[t].push_back((uint32_t)std::min<int64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - op_start).count(), UINT32_MAX));
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    ReplayReport report;
+    report.seconds_ = std::chrono::duration<double>(Clock::now() - replay_start).count();
+    report.ops_ = trace.ops_.size();
+    report.threads_ = thread_count;
+    report.ops_per_second_ = report.seconds_ > 0 ? report.ops_ / report.seconds_ : 0;
+
+    std::vector<uint32_t> all_latencies;
+    for (const auto& thread_latencies : latencies)
+        all_latencies.insert(all_latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    if (!all_latencies.empty()) {
+        std::sort(all_latencies.begin(), all_latencies.end());
+        auto percentile = [&](double fraction) {
+            return (double)all_latencies[std::min(all_latencies.size() - 1, (size_t)(fraction * all_latencies.size()))];
+        };
+        report.p50_ns_ = percentile(0.50);
+        report.p90_ns_ = percentile(0.90);
+        report.p99_ns_ = percentile(0.99);
+        report.p999_ns_ = percentile(0.999);
+        report.max_ns_ = all_latencies.back();
+    }
+
+    for (const auto& shard : shards) {
+        report.final_size_ += shard.Size();
+        report.memory_ += shard.MemoryUsage();
+    }
+    report.max_rss_kb_ = MaxResidentKilobytes();
+    return report;
+}
+
+#endif  // TRACE_REPLAY_H